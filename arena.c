@@ -0,0 +1,284 @@
+/*********************************************************/
+/* ARENA.C ***********************************************/
+/*********************************************************/
+
+/* Bump allocator for tree nodes over large blocks taken
+straight from mmap. Each block is aligned to 2MB and, with
+ARENA_HUGE, marked MADV_HUGEPAGE so the kernel can back it
+with transparent huge pages: nodes from gfmalloc scatter
+over 4K pages and a lookup in a big tree takes a dTLB miss
+on most levels, where one 2MB page covers 64K RBNodes.
+ARENA_INTERLEAVE spreads a block's pages over all NUMA
+nodes and ARENA_BIND keeps them on one. Any of these the
+kernel refuses is dropped and the block is used as it is
+(huge and numa say what took); without mmap the blocks
+come from gfmalloc.
+
+Nodes are not freed one at a time: the tree's nodes all go
+with Arena_free, one munmap per block, or Arena_reset keeps
+the blocks and starts handing them out again from the
+first, so a tree rebuilt over and over costs no system
+calls and no page faults after the first build. Also here,
+a dTLB read-miss counter from perf_event_open for the
+benchmark, -1 where perf is not allowed. */
+
+/* mmap, madvise and syscall are not ANSI */
+#define _GNU_SOURCE
+#include "ext.h"
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+#endif
+
+/* block is rounded up to a whole number of huge pages;
+node is the NUMA node for ARENA_BIND */
+Arena* Arena_init(size_t block, int flags, int node)
+{
+  Arena *a;
+
+  a = (Arena*) gfmalloc(sizeof(Arena));
+  a->first = a->cur = NULL;
+  a->block = (block + ARENA_HUGEPAGE - ONE) /
+    ARENA_HUGEPAGE * ARENA_HUGEPAGE;
+  a->flags = flags;
+  a->node = node;
+  a->huge = a->numa = false;
+  a->blocks = ZERO;
+
+  return a;
+}
+
+/* One 2MB-aligned mapping of size bytes, NULL if mmap is
+missing or fails */
+void* Arena_map(Arena* a, size_t size)
+{
+#ifdef __linux__
+  char *p, *start;
+  size_t lead;
+  unsigned long mask[ARENA_MASKWORDS];
+  int i, mode;
+
+  /* map a huge page extra and trim to alignment */
+  p = (char*) mmap(NULL, size + ARENA_HUGEPAGE,
+    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+    -ONE, ZERO);
+  if(p == MAP_FAILED){
+    return NULL;
+  }
+  lead = (ARENA_HUGEPAGE - (size_t) p % ARENA_HUGEPAGE) %
+    ARENA_HUGEPAGE;
+  start = p + lead;
+  if(lead > ZERO){
+    munmap(p, lead);
+  }
+  munmap(start + size, ARENA_HUGEPAGE - lead);
+
+  if(a->flags & ARENA_HUGE){
+    a->huge = madvise(start, size, MADV_HUGEPAGE) == ZERO;
+  }
+  /* before first touch, so pages are placed as asked */
+  if(a->flags & (ARENA_INTERLEAVE | ARENA_BIND)){
+    for(i = ZERO; i < ARENA_MASKWORDS; i++){
+      mask[i] = ZERO;
+    }
+    if(a->flags & ARENA_BIND){
+      mode = MPOL_BIND;
+      mask[a->node / ARENA_WORDBITS] = 1UL <<
+        (a->node % ARENA_WORDBITS);
+    }
+    else {
+      /* all nodes, the kernel keeps the ones there are */
+      mode = MPOL_INTERLEAVE;
+      for(i = ZERO; i < ARENA_MASKWORDS; i++){
+        mask[i] = ~0UL;
+      }
+    }
+    a->numa = syscall(SYS_mbind, start, size, mode, mask,
+      (unsigned long) ARENA_MASKWORDS * ARENA_WORDBITS,
+      ZERO) == ZERO;
+  }
+  return start;
+#else
+  (void) a;
+  (void) size;
+  return NULL;
+#endif
+}
+
+void* Arena_alloc(Arena* a, size_t size)
+{
+  ArenaBlock *b = a->cur;
+  void *p;
+
+  size = (size + ARENA_ALIGN - ONE) / ARENA_ALIGN *
+    ARENA_ALIGN;
+  if(b == NULL || b->used + size > b->size){
+    if(size + sizeof(ArenaBlock) > a->block){
+      ON_ERROR("Size to Arena_alloc is over a block\n");
+    }
+    /* after a reset the next block is already there */
+    if(b != NULL && b->next != NULL){
+      b = b->next;
+    }
+    else {
+      b = Arena_newblock(a);
+      if(a->cur == NULL){
+        a->first = b;
+      }
+      else {
+        a->cur->next = b;
+      }
+    }
+    b->used = ARENA_HEADER;
+    a->cur = b;
+  }
+  p = (char*) b + b->used;
+  b->used += size;
+
+  return p;
+}
+
+/* A block mapped (or failing that malloc'd) and empty */
+ArenaBlock* Arena_newblock(Arena* a)
+{
+  ArenaBlock *b;
+
+  b = (ArenaBlock*) Arena_map(a, a->block);
+  if(b == NULL){
+    b = (ArenaBlock*) gfmalloc(a->block);
+    b->mapped = false;
+  }
+  else {
+    b->mapped = true;
+  }
+  b->size = a->block;
+  b->used = ARENA_HEADER;
+  b->next = NULL;
+  a->blocks++;
+
+  return b;
+}
+
+/* Give back the last Arena_alloc of size bytes */
+void Arena_pop(Arena* a, size_t size)
+{
+  a->cur->used -= (size + ARENA_ALIGN - ONE) /
+    ARENA_ALIGN * ARENA_ALIGN;
+}
+
+/* RBTree_insert with the node taken from the arena */
+RBNode* Arena_rbinsert(Arena* a, RBTree* tree, int key)
+{
+  RBNode *z, *x;
+
+  z = (RBNode*) Arena_alloc(a, sizeof(RBNode));
+  z->key = key;
+  x = RBTree_insertnode(tree, z);
+  if(x != z){
+    Arena_pop(a, sizeof(RBNode));
+  }
+  return x;
+}
+
+/* Forget every allocation but keep the blocks, O(1): the
+blocks after the first are rewound as they are reached */
+void Arena_reset(Arena* a)
+{
+  if(a->first != NULL){
+    a->first->used = ARENA_HEADER;
+  }
+  a->cur = a->first;
+}
+
+/* Every node from the arena goes at once, one munmap (or
+free) per block */
+void Arena_free(Arena* a)
+{
+  ArenaBlock *b, *next;
+
+  for(b = a->first; b != NULL; b = next){
+    next = b->next;
+#ifdef __linux__
+    if(b->mapped){
+      munmap(b, b->size);
+      continue;
+    }
+#endif
+    free(b);
+  }
+  free(a);
+}
+
+/*********************************************************/
+/* DTLB COUNTER ******************************************/
+/*********************************************************/
+
+/* This thread's user-space dTLB read misses, stopped; the
+fd, or -1 if perf_event_open is not there or not allowed */
+int DTLB_open(void)
+{
+#ifdef __linux__
+  struct perf_event_attr pe;
+
+  memset(&pe, ZERO, sizeof(pe));
+  pe.type = PERF_TYPE_HW_CACHE;
+  pe.size = sizeof(pe);
+  pe.config = PERF_COUNT_HW_CACHE_DTLB |
+    (PERF_COUNT_HW_CACHE_OP_READ << ARENA_PERFOP) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << ARENA_PERFRESULT);
+  pe.disabled = ONE;
+  pe.exclude_kernel = ONE;
+  pe.exclude_hv = ONE;
+
+  return (int) syscall(SYS_perf_event_open, &pe, ZERO,
+    -ONE, -ONE, ZERO);
+#else
+  return -ONE;
+#endif
+}
+
+void DTLB_start(int fd)
+{
+#ifdef __linux__
+  if(fd >= ZERO){
+    ioctl(fd, PERF_EVENT_IOC_RESET, ZERO);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, ZERO);
+  }
+#else
+  (void) fd;
+#endif
+}
+
+/* Misses since DTLB_start, -1 without a counter */
+long DTLB_stop(int fd)
+{
+#ifdef __linux__
+  long count;
+
+  if(fd >= ZERO){
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, ZERO);
+    if(read(fd, &count, sizeof(count)) == (ssize_t)
+      sizeof(count)){
+      return count;
+    }
+  }
+#else
+  (void) fd;
+#endif
+  return -ONE;
+}
+
+void DTLB_close(int fd)
+{
+#ifdef __linux__
+  if(fd >= ZERO){
+    close(fd);
+  }
+#else
+  (void) fd;
+#endif
+}
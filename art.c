@@ -0,0 +1,438 @@
+/*********************************************************/
+/* ART.C *************************************************/
+/*********************************************************/
+
+/* Adaptive radix tree (Leis, Kemper & Neumann) over 8-byte
+keys taken most significant byte first, so keys come out
+of a walk in order. An inner node branches on one byte and
+is the smallest of four kinds that holds its children:
+ARTNode4 and ARTNode16 keep sorted byte arrays, ARTNode48
+a 256-entry index into 48 slots and ARTNode256 a slot for
+every byte; a node that fills is copied into the next kind
+up. The bytes all keys below a node share are kept in the
+node (path compression) so a chain of one-child nodes is
+never built, and a key's leaf hangs as high as the first
+byte telling it from the others (lazy expansion). The
+height is then at most ART_KEYLEN whatever the order of
+insertion, and no key is compared but at its leaf.
+
+int keys have their sign bit flipped so that they order
+as unsigned, and sit in the low 4 bytes. */
+
+#include "ext.h"
+
+ART* ART_init(void)
+{
+  ART *t;
+
+  t = (ART*) gfmalloc(sizeof(ART));
+  t->root = NULL;
+  t->size = ZERO;
+  t->bytes = sizeof(ART);
+
+  return t;
+}
+
+uint64_t ART_intkey(int key)
+{
+  return (uint64_t) ((unsigned int) key ^
+    (unsigned int) INT_MIN);
+}
+
+int ART_keyint(uint64_t key)
+{
+  return (int) ((unsigned int) key ^ (unsigned int) INT_MIN);
+}
+
+/* kb[0] is the most significant byte */
+void ART_keybytes(uint64_t key, unsigned char* kb)
+{
+  int i;
+
+  for(i = ART_KEYLEN - ONE; i >= ZERO; i--){
+    kb[i] = (unsigned char) (key & UCHAR_MAX);
+    key >>= CHAR_BIT;
+  }
+}
+
+ARTNode* ART_newnode(ART* t, unsigned char type)
+{
+  ARTNode *n;
+  size_t size;
+
+  size = ART_nodesize(type);
+  n = (ARTNode*) gfmalloc(size);
+  memset(n, ZERO, size);
+  n->type = type;
+  t->bytes += (long) size;
+
+  return n;
+}
+
+size_t ART_nodesize(unsigned char type)
+{
+  switch(type){
+    case ART_LEAF:
+      return sizeof(ARTLeaf);
+    case ART_4:
+      return sizeof(ARTNode4);
+    case ART_16:
+      return sizeof(ARTNode16);
+    case ART_48:
+      return sizeof(ARTNode48);
+    default:
+      return sizeof(ARTNode256);
+  }
+}
+
+/* Where the child for byte b is, NULL if there is none */
+ARTNode** ART_findchild(ARTNode* n, unsigned char b)
+{
+  ARTNode4 *n4;
+  ARTNode16 *n16;
+  ARTNode48 *n48;
+  int i;
+
+  switch(n->type){
+    case ART_4:
+      n4 = (ARTNode4*) n;
+      for(i = ZERO; i < n->count; i++){
+        if(n4->keys[i] == b){
+          return &n4->child[i];
+        }
+      }
+      return NULL;
+    case ART_16:
+      n16 = (ARTNode16*) n;
+      for(i = ZERO; i < n->count; i++){
+        if(n16->keys[i] == b){
+          return &n16->child[i];
+        }
+      }
+      return NULL;
+    case ART_48:
+      n48 = (ARTNode48*) n;
+      if(n48->index[b] == ZERO){
+        return NULL;
+      }
+      return &n48->child[n48->index[b] - ONE];
+    default:
+      if(((ARTNode256*) n)->child[b] == NULL){
+        return NULL;
+      }
+      return &((ARTNode256*) n)->child[b];
+  }
+}
+
+/* Hang child under byte b of *ref, which has no child for
+b, moving *ref up a kind if it is full */
+void ART_addchild(ART* t, ARTNode** ref, unsigned char b,
+  ARTNode* child)
+{
+  ARTNode *n = *ref;
+  ARTNode4 *n4;
+  ARTNode16 *n16;
+  ARTNode48 *n48;
+  int i;
+
+  if((n->type == ART_4 && n->count == FOUR) ||
+    (n->type == ART_16 && n->count == SIXTEEN) ||
+    (n->type == ART_48 && n->count == ART_MAX48)){
+    n = *ref = ART_grow(t, n);
+  }
+  switch(n->type){
+    /* 4 and 16 keep their keys sorted */
+    case ART_4:
+      n4 = (ARTNode4*) n;
+      for(i = n->count; i > ZERO && n4->keys[i - ONE] > b;
+        i--){
+        n4->keys[i] = n4->keys[i - ONE];
+        n4->child[i] = n4->child[i - ONE];
+      }
+      n4->keys[i] = b;
+      n4->child[i] = child;
+      break;
+    case ART_16:
+      n16 = (ARTNode16*) n;
+      for(i = n->count; i > ZERO && n16->keys[i - ONE] > b;
+        i--){
+        n16->keys[i] = n16->keys[i - ONE];
+        n16->child[i] = n16->child[i - ONE];
+      }
+      n16->keys[i] = b;
+      n16->child[i] = child;
+      break;
+    case ART_48:
+      /* nothing is deleted, so the slots fill in order */
+      n48 = (ARTNode48*) n;
+      n48->child[n->count] = child;
+      n48->index[b] = (unsigned char) (n->count + ONE);
+      break;
+    default:
+      ((ARTNode256*) n)->child[b] = child;
+  }
+  n->count++;
+}
+
+/* The next kind up holding n's children, n is freed */
+ARTNode* ART_grow(ART* t, ARTNode* n)
+{
+  ARTNode *m;
+  ARTNode4 *n4;
+  ARTNode16 *n16, *m16;
+  ARTNode48 *n48, *m48;
+  ARTNode256 *m256;
+  int i;
+
+  if(n->type == ART_4){
+    m = ART_newnode(t, ART_16);
+    n4 = (ARTNode4*) n;
+    m16 = (ARTNode16*) m;
+    for(i = ZERO; i < n->count; i++){
+      m16->keys[i] = n4->keys[i];
+      m16->child[i] = n4->child[i];
+    }
+  }
+  else if(n->type == ART_16){
+    m = ART_newnode(t, ART_48);
+    n16 = (ARTNode16*) n;
+    m48 = (ARTNode48*) m;
+    for(i = ZERO; i < n->count; i++){
+      m48->child[i] = n16->child[i];
+      m48->index[n16->keys[i]] = (unsigned char) (i + ONE);
+    }
+  }
+  else {
+    m = ART_newnode(t, ART_256);
+    n48 = (ARTNode48*) n;
+    m256 = (ARTNode256*) m;
+    for(i = ZERO; i <= UCHAR_MAX; i++){
+      if(n48->index[i] != ZERO){
+        m256->child[i] = n48->child[n48->index[i] - ONE];
+      }
+    }
+  }
+  m->count = n->count;
+  m->prefixlen = n->prefixlen;
+  memcpy(m->prefix, n->prefix, ART_KEYLEN);
+  t->bytes -= (long) ART_nodesize(n->type);
+  free(n);
+
+  return m;
+}
+
+bool ART_insert64(ART* t, uint64_t key)
+{
+  unsigned char kb[ART_KEYLEN];
+
+  ART_keybytes(key, kb);
+  return ART_insertat(t, &t->root, key, kb, ZERO);
+}
+
+/* Insert below *ref, whose first byte is kb[depth]; true if
+key was not there */
+bool ART_insertat(ART* t, ARTNode** ref, uint64_t key,
+  unsigned char* kb, int depth)
+{
+  ARTNode *n = *ref, *m;
+  ARTLeaf *leaf;
+  unsigned char lb[ART_KEYLEN];
+  ARTNode **next;
+  int i;
+
+  if(n == NULL){
+    *ref = ART_newleaf(t, key);
+    return true;
+  }
+
+  /* two keys at one leaf, split it on the first byte they
+  differ in */
+  if(n->type == ART_LEAF){
+    leaf = (ARTLeaf*) n;
+    if(leaf->key == key){
+      return false;
+    }
+    ART_keybytes(leaf->key, lb);
+    m = ART_newnode(t, ART_4);
+    i = ZERO;
+    while(kb[depth + i] == lb[depth + i]){
+      m->prefix[i] = kb[depth + i];
+      i++;
+    }
+    m->prefixlen = (unsigned char) i;
+    ART_addchild(t, &m, lb[depth + i], n);
+    ART_addchild(t, &m, kb[depth + i], ART_newleaf(t, key));
+    *ref = m;
+    return true;
+  }
+
+  /* the key leaves n's prefix part way, a node above n
+  branches there */
+  i = ZERO;
+  while(i < n->prefixlen && n->prefix[i] == kb[depth + i]){
+    i++;
+  }
+  if(i < n->prefixlen){
+    m = ART_newnode(t, ART_4);
+    m->prefixlen = (unsigned char) i;
+    memcpy(m->prefix, n->prefix, (size_t) i);
+    ART_addchild(t, &m, n->prefix[i], n);
+    n->prefixlen = (unsigned char) (n->prefixlen - i - ONE);
+    memmove(n->prefix, n->prefix + i + ONE, n->prefixlen);
+    ART_addchild(t, &m, kb[depth + i], ART_newleaf(t, key));
+    *ref = m;
+    return true;
+  }
+
+  depth += n->prefixlen;
+  next = ART_findchild(n, kb[depth]);
+  if(next != NULL){
+    return ART_insertat(t, next, key, kb, depth + ONE);
+  }
+  ART_addchild(t, ref, kb[depth], ART_newleaf(t, key));
+  return true;
+}
+
+ARTNode* ART_newleaf(ART* t, uint64_t key)
+{
+  ARTLeaf *leaf;
+
+  leaf = (ARTLeaf*) ART_newnode(t, ART_LEAF);
+  leaf->key = key;
+  t->size++;
+
+  return (ARTNode*) leaf;
+}
+
+bool ART_search64(ART* t, uint64_t key)
+{
+  ARTNode *n = t->root, **next;
+  unsigned char kb[ART_KEYLEN];
+  int depth = ZERO;
+
+  ART_keybytes(key, kb);
+  while(n != NULL){
+    if(n->type == ART_LEAF){
+      return ((ARTLeaf*) n)->key == key;
+    }
+    if(memcmp(n->prefix, kb + depth, n->prefixlen) != ZERO){
+      return false;
+    }
+    depth += n->prefixlen;
+    next = ART_findchild(n, kb[depth]);
+    if(next == NULL){
+      return false;
+    }
+    n = *next;
+    depth++;
+  }
+  return false;
+}
+
+void ART_insert(ART* t, int key)
+{
+  ART_insert64(t, ART_intkey(key));
+}
+
+bool ART_search(ART* t, int key)
+{
+  return ART_search64(t, ART_intkey(key));
+}
+
+/* Every key in order into out, which has room for them */
+void ART_getordered(ART* t, uint64_t* out)
+{
+  ARTNode_getordered(t->root, &out);
+}
+
+void ARTNode_getordered(ARTNode* n, uint64_t** out)
+{
+  ARTNode48 *n48;
+  int i;
+
+  if(n == NULL){
+    return;
+  }
+  switch(n->type){
+    case ART_LEAF:
+      *(*out)++ = ((ARTLeaf*) n)->key;
+      break;
+    case ART_4:
+      for(i = ZERO; i < n->count; i++){
+        ARTNode_getordered(((ARTNode4*) n)->child[i], out);
+      }
+      break;
+    case ART_16:
+      for(i = ZERO; i < n->count; i++){
+        ARTNode_getordered(((ARTNode16*) n)->child[i], out);
+      }
+      break;
+    case ART_48:
+      n48 = (ARTNode48*) n;
+      for(i = ZERO; i <= UCHAR_MAX; i++){
+        if(n48->index[i] != ZERO){
+          ARTNode_getordered(n48->child[n48->index[i] - ONE],
+            out);
+        }
+      }
+      break;
+    default:
+      for(i = ZERO; i <= UCHAR_MAX; i++){
+        ARTNode_getordered(((ARTNode256*) n)->child[i], out);
+      }
+  }
+}
+
+/* Nodes on the longest path, leaf included */
+int ART_height(ART* t)
+{
+  return ARTNode_height(t->root);
+}
+
+int ARTNode_height(ARTNode* n)
+{
+  ARTNode **child;
+  int i, h, height = ZERO;
+
+  if(n == NULL){
+    return ZERO;
+  }
+  if(n->type == ART_LEAF){
+    return ONE;
+  }
+  for(i = ZERO; i <= UCHAR_MAX; i++){
+    child = ART_findchild(n, (unsigned char) i);
+    if(child != NULL){
+      h = ARTNode_height(*child);
+      if(h > height){
+        height = h;
+      }
+    }
+  }
+  return height + ONE;
+}
+
+void ART_free(ART* t)
+{
+  ARTNode_free(t->root);
+  free(t);
+}
+
+void ARTNode_free(ARTNode* n)
+{
+  ARTNode **child;
+  int i;
+
+  if(n == NULL){
+    return;
+  }
+  if(n->type != ART_LEAF){
+    for(i = ZERO; i <= UCHAR_MAX; i++){
+      child = ART_findchild(n, (unsigned char) i);
+      if(child != NULL){
+        ARTNode_free(*child);
+      }
+    }
+  }
+  free(n);
+}
@@ -0,0 +1,145 @@
+/*********************************************************/
+/* AVL.C *************************************************/
+/*********************************************************/
+
+/* AVL tree: every node keeps the height of its subtree
+and the two subtree heights never differ by more than one,
+restored by at most two rotations per insert. */
+
+#include "ext.h"
+
+AVLTree* AVL_init(void)
+{
+  AVLTree *tree;
+
+  tree = (AVLTree*) gfmalloc(sizeof(AVLTree));
+  tree->root = NULL;
+
+  return tree;
+}
+
+int AVLNode_h(AVLNode* node)
+{
+  if(node == NULL){
+    return ZERO;
+  }
+  return node->height;
+}
+
+void AVLNode_update(AVLNode* node)
+{
+  int l_height = AVLNode_h(node->left);
+  int r_height = AVLNode_h(node->right);
+
+  if(l_height > r_height){
+    node->height = l_height + ONE;
+  }
+  else {
+    node->height = r_height + ONE;
+  }
+}
+
+AVLNode* AVLNode_rotleft(AVLNode* x)
+{
+  AVLNode *y = x->right;
+
+  x->right = y->left;
+  y->left = x;
+  AVLNode_update(x);
+  AVLNode_update(y);
+
+  return y;
+}
+
+AVLNode* AVLNode_rotright(AVLNode* y)
+{
+  AVLNode *x = y->left;
+
+  y->left = x->right;
+  x->right = y;
+  AVLNode_update(y);
+  AVLNode_update(x);
+
+  return x;
+}
+
+AVLNode* AVLNode_insert(AVLNode* node, int key)
+{
+  int balance;
+
+  if(node == NULL){
+    node = (AVLNode*) gfmalloc(sizeof(AVLNode));
+    node->key = key;
+    node->height = ONE;
+    node->left = node->right = NULL;
+    return node;
+  }
+  if(key < node->key){
+    node->left = AVLNode_insert(node->left, key);
+  }
+  else if(key > node->key){
+    node->right = AVLNode_insert(node->right, key);
+  }
+  else {
+    return node;
+  }
+
+  AVLNode_update(node);
+  balance = AVLNode_h(node->left) - AVLNode_h(node->right);
+  /* left heavy, rotate the left child first if the new
+  key went to its inside */
+  if(balance > ONE){
+    if(key > node->left->key){
+      node->left = AVLNode_rotleft(node->left);
+    }
+    return AVLNode_rotright(node);
+  }
+  /* right heavy, mirror of the above */
+  if(balance < -ONE){
+    if(key < node->right->key){
+      node->right = AVLNode_rotright(node->right);
+    }
+    return AVLNode_rotleft(node);
+  }
+  return node;
+}
+
+void AVL_insert(AVLTree* tree, int key)
+{
+  tree->root = AVLNode_insert(tree->root, key);
+}
+
+bool AVL_search(AVLTree* tree, int key)
+{
+  AVLNode *x = tree->root;
+
+  while(x != NULL && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x != NULL;
+}
+
+int AVL_height(AVLTree* tree)
+{
+  return AVLNode_h(tree->root);
+}
+
+void AVL_free(AVLTree* tree)
+{
+  AVL_recur(tree->root);
+  free(tree);
+}
+
+void AVL_recur(AVLNode* node)
+{
+  if(node != NULL){
+    AVL_recur(node->left);
+    AVL_recur(node->right);
+    free(node);
+  }
+}
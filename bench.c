@@ -0,0 +1,1734 @@
+/*********************************************************/
+/* BENCH.C ***********************************************/
+/*********************************************************/
+
+/* Timing harness for the tree engines. Each benchmark
+takes the number of keys n, builds its trees from the
+same shuffled keys and prints a small table in the same
+layout as the height table in main. */
+
+/* clock_gettime is not ANSI */
+#define _POSIX_C_SOURCE 200112L
+#include "ext.h"
+
+int bench_run(int argc, char* argv[])
+{
+  BenchCase cases[] = {
+    {"rbidx", bench_rbidx},
+    {"rbtd", bench_rbtd},
+    {"engines", bench_engines},
+    {"rbcache", bench_rbcache},
+    {"batch", bench_batch},
+    {"rbtmpl", bench_rbtmpl},
+    {"rbmap", bench_rbmap},
+    {"rbms", bench_rbms},
+    {"rbpers", bench_rbpers},
+    {"rbhash", bench_rbhash},
+    {"arena", bench_arena},
+    {"finger", bench_finger},
+    {"shard", bench_shard},
+    {"rbiv", bench_rbiv},
+    {"rbagg", bench_rbagg},
+    {"pq", bench_pq},
+    {"par", bench_par},
+    {"strkey", bench_strkey},
+    {"art", bench_art},
+    {"wal", bench_wal}
+  };
+  int i, n = BENCH_N, ncases, ran = ZERO;
+  char *name = "all";
+
+  ncases = (int) (sizeof(cases) / sizeof(cases[ZERO]));
+  if(argc > ZERO){
+    name = argv[ZERO];
+  }
+  if(argc > ONE){
+    n = atoi(argv[ONE]);
+  }
+  if(n <= ZERO){
+    ON_ERROR("Size to bench_run is <= 0\n");
+  }
+
+  srand(time(NULL));
+  for(i = ZERO; i < ncases; i++){
+    if(strcmp(name, "all") == ZERO ||
+      strcmp(name, cases[i].name) == ZERO){
+      printf("\n  [%s] n = %d\n", cases[i].name, n);
+      cases[i].run(n);
+      ran++;
+    }
+  }
+  if(ran == ZERO){
+    fprintf(stderr, "Unknown benchmark %s, one of:", name);
+    for(i = ZERO; i < ncases; i++){
+      fprintf(stderr, " %s", cases[i].name);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+  }
+  printf("\n");
+
+  return EXIT_SUCCESS;
+}
+
+/*********************************************************/
+/* HELPERS ***********************************************/
+/*********************************************************/
+
+double bench_secs(clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Wall clock seconds, for timing threads where clock()
+adds up their CPU time */
+double bench_wall(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double bench_nsop(clock_t start, int ops)
+{
+  return bench_secs(start) * 1e9 / ops;
+}
+
+/* Resident set size in kB from /proc, 0 where there is no
+/proc to read */
+long bench_rsskb(void)
+{
+  FILE *fp;
+  char line[BUFSIZ];
+  long kb = ZERO;
+
+  fp = fopen("/proc/self/status", "r");
+  if(fp == NULL){
+    return ZERO;
+  }
+  while(fgets(line, BUFSIZ, fp) != NULL){
+    if(strncmp(line, "VmRSS:", SIX) == ZERO){
+      kb = atol(line + SIX);
+    }
+  }
+  fclose(fp);
+
+  return kb;
+}
+
+/* Fisher-Yates as in randomise, but for any n */
+void bench_shuffle(int* a, int n)
+{
+  int i, j;
+
+  for(i = n - ONE; i > ZERO; i--){
+    j = rand() % (i + ONE);
+    swap(&a[i], &a[j]);
+  }
+}
+
+/* Shuffled 0..n-1, caller frees */
+int* bench_keys(int n)
+{
+  int i, *a;
+
+  a = (int*) gfmalloc((size_t) n * sizeof(int));
+  for(i = ZERO; i < n; i++){
+    a[i] = i;
+  }
+  bench_shuffle(a, n);
+
+  return a;
+}
+
+void bench_header(char* title, char* c1, char* c2, char* c3)
+{
+  printf("\n  %-14s | %-14s | %-14s | %-14s\n",
+    title, c1, c2, c3);
+  printf("  %-14s | %-14s | %-14s | %-14s\n",
+    "--------------", "--------------", "--------------",
+    "--------------");
+}
+
+/* m draws from a zipf(s) distribution over n keys, rank r
+has weight 1/r^s; ranks are mapped through a shuffle so the
+hot keys are spread over the key range */
+int* bench_zipf(int n, int m, double s)
+{
+  double *cdf, u, sum = ZERO;
+  int i, lo, hi, mid, *perm, *q;
+
+  cdf = (double*) gfmalloc((size_t) n * sizeof(double));
+  for(i = ZERO; i < n; i++){
+    sum += ONE / pow((double) i + ONE, s);
+    cdf[i] = sum;
+  }
+  perm = bench_keys(n);
+  q = (int*) gfmalloc((size_t) m * sizeof(int));
+  for(i = ZERO; i < m; i++){
+    u = sum * ((double) rand() / ((double) RAND_MAX + ONE));
+    lo = ZERO;
+    hi = n - ONE;
+    while(lo < hi){
+      mid = (lo + hi) / TWO;
+      if(cdf[mid] < u){
+        lo = mid + ONE;
+      }
+      else {
+        hi = mid;
+      }
+    }
+    q[i] = perm[lo];
+  }
+  free(cdf);
+  free(perm);
+
+  return q;
+}
+
+/* m draws that stay within a window of w neighbouring keys
+which slides one key along every w/16 queries */
+int* bench_local(int n, int m, int w)
+{
+  int i, base = ZERO, *q;
+
+  if(w > n){
+    w = n;
+  }
+  q = (int*) gfmalloc((size_t) m * sizeof(int));
+  for(i = ZERO; i < m; i++){
+    if(i % (w / SIXTEEN + ONE) == ZERO){
+      base = (base + ONE) % n;
+    }
+    q[i] = (base + rand() % w) % n;
+  }
+
+  return q;
+}
+
+/* Binary min-heap in h[0..*size-1], the baseline priority
+queue for bench_pq */
+void bench_heappush(int* h, int* size, int key)
+{
+  int i, parent;
+
+  i = (*size)++;
+  while(i > ZERO){
+    parent = (i - ONE) / TWO;
+    if(h[parent] <= key){
+      break;
+    }
+    h[i] = h[parent];
+    i = parent;
+  }
+  h[i] = key;
+}
+
+/* Smallest key, the heap must not be empty */
+int bench_heappop(int* h, int* size)
+{
+  int top = h[ZERO], last, i = ZERO, child;
+
+  last = h[--(*size)];
+  for(;;){
+    child = TWO * i + ONE;
+    if(child >= *size){
+      break;
+    }
+    if(child + ONE < *size && h[child + ONE] < h[child]){
+      child++;
+    }
+    if(h[child] >= last){
+      break;
+    }
+    h[i] = h[child];
+    i = child;
+  }
+  h[i] = last;
+
+  return top;
+}
+
+/*********************************************************/
+/* BENCHMARKS ********************************************/
+/*********************************************************/
+
+/* Pointer RBTree vs index-pool RBIdx: build time, memory
+per key (node size and measured rss growth) and random
+lookup time */
+void bench_rbidx(int n)
+{
+  RBTree *tree;
+  RBIdxTree *itree;
+  int i, *a, *q, hits = ZERO, rb_height;
+  long rss;
+  clock_t t;
+  double build, look, kb;
+
+  a = bench_keys(n);
+  q = bench_keys(n);
+  bench_header("Engine", "Build ns/op", "Lookup ns/op",
+    "Bytes/key");
+
+  rss = bench_rsskb();
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, a[i]);
+  }
+  build = bench_nsop(t, n);
+  kb = (double) (bench_rsskb() - rss);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTree_search(tree, q[i]) != tree->nil;
+  }
+  look = bench_nsop(t, n);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBTree", build, look, kb * KB / n);
+  rb_height = RBNode_height(tree, tree->root->left);
+  RBTree_free(tree);
+
+  rss = bench_rsskb();
+  t = clock();
+  itree = RBIdx_init((uint32_t) n + ONE);
+  for(i = ZERO; i < n; i++){
+    RBIdx_insert(itree, a[i]);
+  }
+  build = bench_nsop(t, n);
+  kb = (double) (bench_rsskb() - rss);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBIdx_search(itree, q[i]) != RBIDX_NIL;
+  }
+  look = bench_nsop(t, n);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBIdx", build, look, kb * KB / n);
+
+  printf("\n  sizeof RBNode %d, RBIdxNode %d, heights %d/%d,"
+    " %d hits\n", (int) sizeof(RBNode),
+    (int) sizeof(RBIdxNode), rb_height,
+    RBIdx_height(itree, itree->root), hits);
+  RBIdx_free(itree);
+
+  free(a);
+  free(q);
+}
+
+/* Bottom-up RBTree vs top-down RBTD: random and sorted
+insert, lookup, and (top-down only) delete */
+void bench_rbtd(int n)
+{
+  RBTree *tree;
+  RBTDTree *ttree;
+  int i, *a, hits = ZERO;
+  clock_t t;
+  double rnd, srt, look, del;
+
+  a = bench_keys(n);
+  bench_header("Engine", "Random ns/op", "Sorted ns/op",
+    "Lookup ns/op");
+
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, a[i]);
+  }
+  rnd = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTree_search(tree, i) != tree->nil;
+  }
+  look = bench_nsop(t, n);
+  RBTree_free(tree);
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, i);
+  }
+  srt = bench_nsop(t, n);
+  RBTree_free(tree);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBTree", rnd, srt, look);
+
+  t = clock();
+  ttree = RBTD_init();
+  for(i = ZERO; i < n; i++){
+    RBTD_insert(ttree, a[i]);
+  }
+  rnd = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTD_search(ttree, i) != NULL;
+  }
+  look = bench_nsop(t, n);
+  bench_shuffle(a, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTD_delete(ttree, a[i]);
+  }
+  del = bench_nsop(t, n);
+  RBTD_free(ttree);
+  t = clock();
+  ttree = RBTD_init();
+  for(i = ZERO; i < n; i++){
+    RBTD_insert(ttree, i);
+  }
+  srt = bench_nsop(t, n);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBTD", rnd, srt, look);
+
+  printf("\n  sizeof RBNode %d, RBTDNode %d, RBTD delete %.1f"
+    " ns/op, sorted height %d, %d hits\n",
+    (int) sizeof(RBNode), (int) sizeof(RBTDNode), del,
+    RBTD_height(ttree->root), hits);
+  RBTD_free(ttree);
+
+  free(a);
+}
+
+/* Every engine in the engine table on the same workloads:
+random and sorted build, then uniform, zipfian and local
+lookups against the randomly built tree */
+void bench_engines(int n)
+{
+  Engine *engines, *e;
+  void *tree;
+  int i, j, nengines, hits = ZERO;
+  int *a, *uni, *zipf, *local;
+  clock_t t;
+  double rnd, srt, look[THREE];
+
+  engines = engine_table(&nengines);
+  a = bench_keys(n);
+  uni = bench_keys(n);
+  zipf = bench_zipf(n, n, ZIPF_S);
+  local = bench_local(n, n, LOCAL_W);
+
+  printf("\n  %-12s | %-12s | %-12s | %-12s | %-12s | %-12s\n",
+    "ns/op", "Random ins", "Sorted ins", "Uniform get",
+    "Zipf get", "Local get");
+  printf("  %-12s | %-12s | %-12s | %-12s | %-12s | %-12s\n",
+    "------------", "------------", "------------",
+    "------------", "------------", "------------");
+  for(i = ZERO; i < nengines; i++){
+    e = &engines[i];
+
+    t = clock();
+    tree = e->init();
+    for(j = ZERO; j < n; j++){
+      e->insert(tree, j);
+    }
+    srt = bench_nsop(t, n);
+    e->free(tree);
+
+    t = clock();
+    tree = e->init();
+    for(j = ZERO; j < n; j++){
+      e->insert(tree, a[j]);
+    }
+    rnd = bench_nsop(t, n);
+
+    t = clock();
+    for(j = ZERO; j < n; j++){
+      hits += e->search(tree, uni[j]);
+    }
+    look[ZERO] = bench_nsop(t, n);
+    t = clock();
+    for(j = ZERO; j < n; j++){
+      hits += e->search(tree, zipf[j]);
+    }
+    look[ONE] = bench_nsop(t, n);
+    t = clock();
+    for(j = ZERO; j < n; j++){
+      hits += e->search(tree, local[j]);
+    }
+    look[TWO] = bench_nsop(t, n);
+    e->free(tree);
+
+    printf("  %-12s | %-12.1f | %-12.1f | %-12.1f | %-12.1f"
+      " | %-12.1f\n", e->name, rnd, srt, look[ZERO],
+      look[ONE], look[TWO]);
+  }
+  printf("\n  %d hits\n", hits);
+
+  free(a);
+  free(uni);
+  free(zipf);
+  free(local);
+}
+
+/* Zipfian lookups through caches of different sizes, with
+a delete and re-insert of a random key every CHURN lookups
+to exercise invalidation; each answer is checked against a
+membership array */
+void bench_rbcache(int n)
+{
+  RBTree *tree;
+  RBCache *c;
+  int sizes[] = {ZERO, 4096, 65536};
+  int i, j, k, *a, *q, wrong;
+  bool *present;
+  clock_t t;
+  double ns;
+  char label[BUFSIZ];
+
+  a = bench_keys(n);
+  q = bench_zipf(n, n, ZIPF_S);
+  present = (bool*) gfmalloc((size_t) n * sizeof(bool));
+  bench_header("Cache slots", "Lookup ns/op", "Hit rate",
+    "Probes/lookup");
+
+  /* one tree for all runs so every cache sees the same
+node layout, the churn carries over through present */
+  tree = RBTree_init();
+  for(j = ZERO; j < n; j++){
+    RBTree_insert(tree, a[j]);
+    present[j] = true;
+  }
+  for(i = ZERO; i < THREE; i++){
+    c = RBCache_init(tree, sizes[i]);
+    wrong = ZERO;
+
+    t = clock();
+    for(j = ZERO; j < n; j++){
+      if(j % CHURN == ZERO){
+        k = q[rand() % n];
+        if(present[k]){
+          RBCache_delete(c, k);
+        }
+        else {
+          RBCache_insert(c, k);
+        }
+        present[k] = !present[k];
+      }
+      wrong += (RBCache_search(c, q[j]) != tree->nil) !=
+        present[q[j]];
+    }
+    ns = bench_nsop(t, n);
+
+    sprintf(label, "%d", sizes[i]);
+    printf("  %-14s | %-14.1f | %-14.3f | %-14.2f\n", label,
+      ns, RBCache_hitrate(c), (double) c->probes / n);
+    if(wrong != ZERO){
+      printf("  %d wrong answers\n", wrong);
+    }
+    RBCache_free(c);
+  }
+  RBTree_free(tree);
+
+  free(a);
+  free(q);
+  free(present);
+}
+
+/* Sequential RBTree_search against RBTree_searchbatch on
+uniform random lookups, in batches of several sizes; the
+gain shows once the tree is well beyond the last level
+cache (e.g. n = 10000000) */
+void bench_batch(int n)
+{
+  RBTree *tree;
+  RBNode **out;
+  int batches[] = {RB_BATCH, 256, 4096};
+  int i, j, *a, *q, hits = ZERO, nbatch;
+  clock_t t;
+  double seq, ns;
+  char label[BUFSIZ];
+
+  a = bench_keys(n);
+  q = bench_keys(n);
+  out = (RBNode**) gfmalloc((size_t) n * sizeof(RBNode*));
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, a[i]);
+  }
+  bench_header("Lookup", "ns/op", "Speedup", "Hits");
+
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTree_search(tree, q[i]) != tree->nil;
+  }
+  seq = bench_nsop(t, n);
+  printf("  %-14s | %-14.1f | %-14.2f | %-14d\n",
+    "sequential", seq, 1.0, hits);
+
+  for(j = ZERO; j < THREE; j++){
+    hits = ZERO;
+    t = clock();
+    for(i = ZERO; i < n; i += batches[j]){
+      nbatch = batches[j];
+      if(i + nbatch > n){
+        nbatch = n - i;
+      }
+      RBTree_searchbatch(tree, q + i, nbatch, out + i);
+    }
+    ns = bench_nsop(t, n);
+    for(i = ZERO; i < n; i++){
+      hits += out[i] != tree->nil && out[i]->key == q[i];
+    }
+    sprintf(label, "batch of %d", batches[j]);
+    printf("  %-14s | %-14.1f | %-14.2f | %-14d\n",
+      label, ns, seq / ns, hits);
+  }
+
+  RBTree_free(tree);
+  free(out);
+  free(a);
+  free(q);
+}
+
+/* Hand-written RBTree against the RBInt instance of the
+template: random insert and lookups (both trees built from
+fresh memory before either is freed, so neither inherits
+the other's scattered free list), then sorted insert */
+void bench_rbtmpl(int n)
+{
+  RBTree *tree;
+  RBInt *itree;
+  RBInt_node *x;
+  int i, *a, *q, hits = ZERO, prev = -ONE, sorted = ONE;
+  clock_t t;
+  double rnd[TWO], srt[TWO], look[TWO];
+
+  a = bench_keys(n);
+  q = bench_keys(n);
+  bench_header("Engine", "Random ns/op", "Sorted ns/op",
+    "Lookup ns/op");
+
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, a[i]);
+  }
+  rnd[ZERO] = bench_nsop(t, n);
+  t = clock();
+  itree = RBInt_init();
+  for(i = ZERO; i < n; i++){
+    RBInt_insert(itree, a[i]);
+  }
+  rnd[ONE] = bench_nsop(t, n);
+
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBTree_search(tree, q[i]) != tree->nil;
+  }
+  look[ZERO] = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits += RBInt_search(itree, q[i]) != NULL;
+  }
+  look[ONE] = bench_nsop(t, n);
+  RBTree_free(tree);
+  RBInt_free(itree);
+
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, i);
+  }
+  srt[ZERO] = bench_nsop(t, n);
+  RBTree_free(tree);
+  t = clock();
+  itree = RBInt_init();
+  for(i = ZERO; i < n; i++){
+    RBInt_insert(itree, i);
+  }
+  srt[ONE] = bench_nsop(t, n);
+
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBTree", rnd[ZERO], srt[ZERO], look[ZERO]);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "RBInt", rnd[ONE], srt[ONE], look[ONE]);
+
+  /* in-order walk must give 0..n-1 */
+  for(x = RBInt_first(itree); x != NULL; x = RBInt_next(x)){
+    sorted = sorted && x->key == prev + ONE;
+    prev = x->key;
+  }
+  printf("\n  %d hits, in order %s\n", hits,
+    sorted && prev == n - ONE ? "yes" : "no");
+  RBInt_free(itree);
+
+  free(a);
+  free(q);
+}
+
+/* Counting a stream of n keys drawn uniformly from 0..n-1
+(so about 63% of them are distinct) into an RBMap, once as
+lookup-then-insert, which walks the tree twice for every
+new key, and once with a single upsert per key. Both maps
+are kept until the end so each is built from fresh
+memory */
+void bench_rbmap(int n)
+{
+  RBMap *map[TWO];
+  long *slot, total;
+  bool inserted;
+  int i, j, *q;
+  clock_t t;
+  double ns;
+  RBMap_node *x;
+
+  q = (int*) gfmalloc((size_t) n * sizeof(int));
+  for(i = ZERO; i < n; i++){
+    q[i] = rand() % n;
+  }
+  bench_header("Count keys", "ns/op", "Distinct",
+    "Total count");
+  for(j = ZERO; j < TWO; j++){
+    map[j] = RBMap_init();
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      if(j == ZERO){
+        slot = RBMap_getptr(map[j], q[i]);
+        if(slot == NULL){
+          RBMap_put(map[j], q[i], ONE);
+        }
+        else {
+          (*slot)++;
+        }
+      }
+      else {
+        slot = RBMap_upsert(map[j], q[i], &inserted);
+        if(inserted){
+          *slot = ZERO;
+        }
+        (*slot)++;
+      }
+    }
+    ns = bench_nsop(t, n);
+    total = ZERO;
+    for(x = RBMap_first(map[j]); x != NULL;
+      x = RBMap_next(x)){
+      total += x->val;
+    }
+    printf("  %-14s | %-14.1f | %-14d | %-14ld\n",
+      j == ZERO ? "get then put" : "upsert", ns,
+      map[j]->size, total);
+  }
+  RBMap_free(map[ZERO]);
+  RBMap_free(map[ONE]);
+  free(q);
+}
+
+/* A zipfian stream of n keys over n/16 distinct values
+into an RBMS multiset, where most inserts are repeats that
+only bump a count, then count, rank and select on every
+key of the stream. Last, walking the keys by select checks
+that rank and select agree with the counts */
+void bench_rbms(int n)
+{
+  RBTree *tree;
+  int i, key, *q, distinct = ZERO, bad = ZERO;
+  double ns[FOUR];
+  long sink = ZERO;
+  clock_t t;
+
+  q = bench_zipf(n / SIXTEEN + ONE, n, ZIPF_S);
+  tree = RBMS_init();
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    RBMS_insert(tree, q[i]);
+  }
+  ns[ZERO] = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    sink += RBMS_count(tree, q[i]);
+  }
+  ns[ONE] = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    sink += RBMS_rank(tree, q[i]);
+  }
+  ns[TWO] = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    sink += RBMS_select(tree, i);
+  }
+  ns[THREE] = bench_nsop(t, n);
+
+  /* copies of key k must sit at ranks rank(k) ..
+  rank(k)+count(k)-1 */
+  for(i = ZERO; i < RBMS_size(tree);
+    i += RBMS_count(tree, key)){
+    key = RBMS_select(tree, i);
+    bad += RBMS_rank(tree, key) != i;
+    distinct++;
+  }
+
+  bench_header("Multiset op", "ns/op", "Distinct",
+    "Copies");
+  printf("  %-14s | %-14.1f | %-14d | %-14d\n", "insert",
+    ns[ZERO], distinct, RBMS_size(tree));
+  printf("  %-14s | %-14.1f |\n", "count", ns[ONE]);
+  printf("  %-14s | %-14.1f |\n", "rank", ns[TWO]);
+  printf("  %-14s | %-14.1f |\n", "select", ns[THREE]);
+  printf("\n  %d rank/select mismatches (checksum %ld)\n",
+    bad, sink);
+
+  RBTree_free(tree);
+  free(q);
+}
+
+/* n random inserts into the mutable RBTree and into the
+persistent tree, the second time keeping a snapshot every
+KB inserts. A snapshot of the RBTree means copying it, done
+here the only way it can be, by reinserting its keys. Each
+snapshot must still hold exactly the keys inserted before
+it was taken */
+void bench_rbpers(int n)
+{
+  RBTree *tree, *copy;
+  RBNode *x;
+  RBPTree *ptree[TWO];
+  RBPNode **snap;
+  int i, j, nsnap = ZERO, *a;
+  double ins[THREE], snapns;
+  bool ok = true;
+  clock_t t;
+
+  a = bench_keys(n);
+  snap = (RBPNode**) gfmalloc(((size_t) n / KB + ONE) *
+    sizeof(RBPNode*));
+
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, a[i]);
+  }
+  ins[ZERO] = bench_nsop(t, n);
+  t = clock();
+  ptree[ZERO] = RBP_init();
+  for(i = ZERO; i < n; i++){
+    RBP_insert(ptree[ZERO], a[i]);
+  }
+  ins[ONE] = bench_nsop(t, n);
+  t = clock();
+  ptree[ONE] = RBP_init();
+  for(i = ZERO; i < n; i++){
+    if(i % KB == ZERO){
+      snap[nsnap++] = RBP_snapshot(ptree[ONE]);
+    }
+    RBP_insert(ptree[ONE], a[i]);
+  }
+  ins[TWO] = bench_nsop(t, n);
+
+  t = clock();
+  copy = RBTree_init();
+  x = RBTree_minimum(tree, tree->root->left);
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(copy, x->key);
+    x = RBTree_next(tree, x);
+  }
+  snapns = bench_secs(t) * 1e9;
+  RBTree_free(copy);
+
+  bench_header("Tree", "Insert ns/op", "Nodes/insert",
+    "Snapshot ns");
+  printf("  %-14s | %-14.1f | %-14.2f | %-14.0f\n",
+    "RBTree", ins[ZERO], (double) ONE, snapns);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    RBP_release(RBP_snapshot(ptree[ZERO]));
+  }
+  snapns = bench_nsop(t, n);
+  printf("  %-14s | %-14.1f | %-14.2f | %-14.0f\n",
+    "Persistent", ins[ONE],
+    (double) ptree[ZERO]->allocs / n, snapns);
+  printf("  %-14s | %-14.1f | %-14.2f |\n",
+    "Snap every KB", ins[TWO],
+    (double) ptree[ONE]->allocs / n);
+
+  for(j = ZERO; j < nsnap; j++){
+    i = j * KB;
+    ok = ok && !RBP_search(snap[j], a[i]) &&
+      (i == ZERO || RBP_search(snap[j], a[i - ONE]));
+    RBP_release(snap[j]);
+  }
+  printf("\n  %d snapshots consistent %s, height %d\n", nsnap,
+    ok ? "yes" : "no", RBP_height(ptree[ONE]->root));
+
+  RBTree_free(tree);
+  RBP_free(ptree[ZERO]);
+  RBP_free(ptree[ONE]);
+  free(snap);
+  free(a);
+}
+
+/* The same n random inserts, n lookups (half of them
+misses) and n/2 deletes on a bare RBTree and on an RBTree
+with the hash index kept beside it */
+void bench_rbhash(int n)
+{
+  RBTree *tree[TWO];
+  RBHash *h;
+  int i, *a, *q, hits[TWO] = {ZERO, ZERO};
+  double ns[THREE][TWO];
+  clock_t t;
+
+  a = bench_keys(n);
+  q = (int*) gfmalloc((size_t) n * sizeof(int));
+  for(i = ZERO; i < n; i++){
+    q[i] = rand() % (TWO * n);
+  }
+
+  t = clock();
+  tree[ZERO] = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree[ZERO], a[i]);
+  }
+  ns[ZERO][ZERO] = bench_nsop(t, n);
+  t = clock();
+  tree[ONE] = RBTree_init();
+  h = RBHash_init(tree[ONE], ZERO);
+  for(i = ZERO; i < n; i++){
+    RBHash_insert(h, a[i]);
+  }
+  ns[ZERO][ONE] = bench_nsop(t, n);
+
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits[ZERO] += RBTree_search(tree[ZERO], q[i]) !=
+      tree[ZERO]->nil;
+  }
+  ns[ONE][ZERO] = bench_nsop(t, n);
+  t = clock();
+  for(i = ZERO; i < n; i++){
+    hits[ONE] += RBHash_isin(h, q[i]);
+  }
+  ns[ONE][ONE] = bench_nsop(t, n);
+
+  bench_header("Operation", "RBTree ns/op", "+index ns/op",
+    "Speedup");
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.2f\n", "insert",
+    ns[ZERO][ZERO], ns[ZERO][ONE],
+    ns[ZERO][ZERO] / ns[ZERO][ONE]);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.2f\n", "lookup",
+    ns[ONE][ZERO], ns[ONE][ONE], ns[ONE][ZERO] / ns[ONE][ONE]);
+  printf("\n  tree %.1f bytes/key, index %.1f bytes/key\n",
+    (double) sizeof(RBNode),
+    (double) RBHash_bytes(h) / h->size);
+
+  t = clock();
+  for(i = ZERO; i < n / TWO; i++){
+    RBTree_delete(tree[ZERO], a[i]);
+  }
+  ns[TWO][ZERO] = bench_nsop(t, n / TWO);
+  t = clock();
+  for(i = ZERO; i < n / TWO; i++){
+    RBHash_delete(h, a[i]);
+  }
+  ns[TWO][ONE] = bench_nsop(t, n / TWO);
+  printf("  delete %.1f vs %.1f ns/op, %d/%d lookup hits, "
+    "%d keys left in both\n", ns[TWO][ZERO], ns[TWO][ONE],
+    hits[ZERO], hits[ONE], h->size);
+
+  RBHash_free(h);
+  RBTree_free(tree[ZERO]);
+  RBTree_free(tree[ONE]);
+  free(a);
+  free(q);
+}
+
+/* The same random tree with nodes from gfmalloc, from an
+arena of ordinary pages and from arenas asking for huge
+pages (and interleaving over NUMA nodes), then n random
+lookups in each with the dTLB read misses they take, n/a
+where perf_event_open is not allowed */
+void bench_arena(int n)
+{
+  RBTree *tree;
+  Arena *a = NULL;
+  int i, c, fd, *keys, *q, hits = ZERO;
+  int flags[FOUR] = {ZERO, ZERO, ARENA_HUGE,
+    ARENA_HUGE | ARENA_INTERLEAVE};
+  char *names[FOUR] = {"gfmalloc", "arena", "arena huge",
+    "huge+numa"}, miss[SIXTEEN];
+  double build;
+  long tlb;
+  clock_t t;
+
+  keys = bench_keys(n);
+  q = bench_keys(n);
+  fd = DTLB_open();
+  bench_header("Nodes from", "Build ns/op", "Lookup ns/op",
+    "dTLB miss/op");
+
+  for(c = ZERO; c < FOUR; c++){
+    t = clock();
+    tree = RBTree_init();
+    if(c > ZERO){
+      a = Arena_init(ARENA_BLOCK, flags[c], ZERO);
+    }
+    for(i = ZERO; i < n; i++){
+      if(c == ZERO){
+        RBTree_insert(tree, keys[i]);
+      }
+      else {
+        Arena_rbinsert(a, tree, keys[i]);
+      }
+    }
+    build = bench_nsop(t, n);
+
+    DTLB_start(fd);
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += RBTree_search(tree, q[i]) != tree->nil;
+    }
+    tlb = DTLB_stop(fd);
+    if(tlb < ZERO){
+      sprintf(miss, "n/a");
+    }
+    else {
+      sprintf(miss, "%.2f", (double) tlb / n);
+    }
+    printf("  %-14s | %-14.1f | %-14.1f | %-14s\n",
+      names[c], build, bench_nsop(t, n), miss);
+
+    if(c == ZERO){
+      RBTree_free(tree);
+    }
+    else {
+      if((flags[c] & ARENA_HUGE) && !a->huge){
+        printf("  (madvise refused, ordinary pages)\n");
+      }
+      if((flags[c] & ARENA_INTERLEAVE) && !a->numa){
+        printf("  (mbind refused, default placement)\n");
+      }
+      RBTree_freeshell(tree);
+      Arena_free(a);
+    }
+  }
+  printf("\n  %d hits\n", hits);
+
+  DTLB_close(fd);
+  free(keys);
+  free(q);
+}
+
+/* Streams of n inserts into an RBTree from the root and
+through a finger: ascending and descending runs (the
+append case), a random walk of steps up to FINGER_WALK
+either way, and shuffled keys where the finger can only
+lose. Both trees must come out holding the same keys */
+void bench_finger(int n)
+{
+  RBTree *tree[TWO];
+  RBFinger f;
+  RBNode *x, *y;
+  int i, s, *keys[FOUR], bad = ZERO;
+  char *names[FOUR] = {"ascending", "descending", "walk",
+    "shuffled"};
+  double ns[TWO];
+  clock_t t;
+
+  for(s = ZERO; s < THREE; s++){
+    keys[s] = (int*) gfmalloc((size_t) n * sizeof(int));
+  }
+  keys[THREE] = bench_keys(n);
+  for(i = ZERO; i < n; i++){
+    keys[ZERO][i] = i;
+    keys[ONE][i] = n - i;
+    keys[TWO][i] = i == ZERO ? ZERO : keys[TWO][i - ONE] +
+      rand() % (TWO * FINGER_WALK + ONE) - FINGER_WALK;
+  }
+
+  bench_header("Insert stream", "Root ns/op",
+    "Finger ns/op", "Speedup");
+  for(s = ZERO; s < FOUR; s++){
+    tree[ZERO] = RBTree_init();
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      RBTree_insert(tree[ZERO], keys[s][i]);
+    }
+    ns[ZERO] = bench_nsop(t, n);
+
+    tree[ONE] = RBTree_init();
+    RBFinger_init(tree[ONE], &f);
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      RBTree_insertfinger(tree[ONE], &f, keys[s][i]);
+    }
+    ns[ONE] = bench_nsop(t, n);
+
+    printf("  %-14s | %-14.1f | %-14.1f | %-14.2f\n",
+      names[s], ns[ZERO], ns[ONE], ns[ZERO] / ns[ONE]);
+
+    x = RBTree_minimum(tree[ZERO], tree[ZERO]->root->left);
+    y = RBTree_minimum(tree[ONE], tree[ONE]->root->left);
+    while(x != tree[ZERO]->nil && y != tree[ONE]->nil){
+      bad += x->key != y->key;
+      x = RBTree_next(tree[ZERO], x);
+      y = RBTree_next(tree[ONE], y);
+    }
+    bad += x != tree[ZERO]->nil || y != tree[ONE]->nil;
+    bad += RBTree_validate(tree[ONE], stderr);
+
+    RBTree_free(tree[ZERO]);
+    RBTree_free(tree[ONE]);
+  }
+  printf("\n  %d differences from the root inserts\n", bad);
+
+  for(s = ZERO; s < FOUR; s++){
+    free(keys[s]);
+  }
+}
+
+/* n shuffled keys inserted by 1 to SHARD_THREADS threads
+into one RBTree behind one lock (a single shard) and into
+SHARD_K shards with bounds from a sample, timed by the
+wall clock; then a full range scan, which must give back
+0..n-1 in order, and the same keys put into shards split
+evenly over the ints, where they all land in one or two,
+before and after a rebalance */
+void bench_shard(int n)
+{
+  RBShards *s;
+  int i, threads, *keys, *out, count, bad = ZERO;
+  double start, ns[TWO], base = ZERO;
+
+  keys = bench_keys(n);
+  out = (int*) gfmalloc((size_t) n * sizeof(int));
+
+  bench_header("Threads", "1 lock ns/op", "Sharded ns/op",
+    "Scaling");
+  for(threads = ONE; threads <= SHARD_THREADS;
+    threads *= TWO){
+    s = RBShard_init(ONE, NULL, ZERO);
+    start = bench_wall();
+    RBShard_insertall(s, keys, n, threads);
+    ns[ZERO] = (bench_wall() - start) * 1e9 / n;
+    RBShard_free(s);
+
+    s = RBShard_init(SHARD_K, keys, n < SHARD_SAMPLE ? n :
+      SHARD_SAMPLE);
+    start = bench_wall();
+    RBShard_insertall(s, keys, n, threads);
+    ns[ONE] = (bench_wall() - start) * 1e9 / n;
+    bad += RBShard_size(s) != n;
+    if(threads == ONE){
+      base = ns[ONE];
+    }
+    printf("  %-14d | %-14.1f | %-14.1f | %-14.2f\n",
+      threads, ns[ZERO], ns[ONE], base / ns[ONE]);
+
+    if(threads * TWO > SHARD_THREADS){
+      start = bench_wall();
+      count = RBShard_range(s, INT_MIN, INT_MAX, out, n);
+      printf("\n  range scan of all %d shards: %.1f ns/key\n",
+        SHARD_K, (bench_wall() - start) * 1e9 / n);
+      bad += count != n;
+      for(i = ZERO; i < count; i++){
+        bad += out[i] != i;
+      }
+    }
+    RBShard_free(s);
+  }
+
+  s = RBShard_init(SHARD_K, NULL, ZERO);
+  RBShard_insertall(s, keys, n, ONE);
+  printf("  even split: largest shard %ld keys\n",
+    RBShard_largest(s));
+  start = bench_wall();
+  RBShard_rebalance(s);
+  printf("  rebalanced in %.1f ms: largest %ld keys\n",
+    (bench_wall() - start) * 1e3, RBShard_largest(s));
+  count = RBShard_range(s, INT_MIN, INT_MAX, out, n);
+  bad += count != n;
+  for(i = ZERO; i < count; i++){
+    bad += out[i] != i;
+  }
+  printf("\n  %d wrong sizes or keys\n", bad);
+
+  RBShard_free(s);
+  free(keys);
+  free(out);
+}
+
+/* n random intervals up to RBIV_LEN long over 0..n-1, then
+RBIV_QUERIES stabbing and overlap queries answered by the
+interval tree and by a scan of all n, which must agree on
+how many intervals each query meets */
+void bench_rbiv(int n)
+{
+  RBTree *tree;
+  Interval *iv, *out;
+  int i, j, q, a, b, *qs, *counts, got, bad = ZERO;
+  long hits[TWO] = {ZERO, ZERO};
+  double ns[TWO][TWO];
+  clock_t t;
+
+  iv = (Interval*) gfmalloc((size_t) n * sizeof(Interval));
+  out = (Interval*) gfmalloc((size_t) n * sizeof(Interval));
+  qs = (int*) gfmalloc(RBIV_QUERIES * sizeof(int));
+  counts = (int*) gfmalloc(RBIV_QUERIES * sizeof(int));
+  tree = RBIV_init();
+  for(i = ZERO; i < n; i++){
+    iv[i].lo = rand() % n;
+    iv[i].hi = iv[i].lo + rand() % RBIV_LEN;
+    RBIV_insert(tree, iv[i].lo, iv[i].hi);
+  }
+  for(i = ZERO; i < RBIV_QUERIES; i++){
+    qs[i] = rand() % n;
+  }
+
+  /* q = 0 stabs at qs[i], q = 1 overlaps a window of
+  RBIV_LEN from there */
+  for(q = ZERO; q < TWO; q++){
+    t = clock();
+    for(i = ZERO; i < RBIV_QUERIES; i++){
+      counts[i] = RBIV_overlap(tree, qs[i], qs[i] + q *
+        RBIV_LEN, out, n);
+      hits[q] += counts[i];
+    }
+    ns[q][ZERO] = bench_nsop(t, RBIV_QUERIES);
+
+    t = clock();
+    for(i = ZERO; i < RBIV_QUERIES; i++){
+      a = qs[i];
+      b = a + q * RBIV_LEN;
+      got = ZERO;
+      for(j = ZERO; j < n; j++){
+        got += iv[j].lo <= b && iv[j].hi >= a;
+      }
+      bad += got != counts[i];
+    }
+    ns[q][ONE] = bench_nsop(t, RBIV_QUERIES);
+  }
+
+  bench_header("Query", "Tree ns/op", "Scan ns/op",
+    "Matches/op");
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n", "stab",
+    ns[ZERO][ZERO], ns[ZERO][ONE],
+    (double) hits[ZERO] / RBIV_QUERIES);
+  printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+    "overlap", ns[ONE][ZERO], ns[ONE][ONE],
+    (double) hits[ONE] / RBIV_QUERIES);
+  printf("\n  %d queries where tree and scan disagree\n",
+    bad);
+
+  RBIV_free(tree);
+  free(iv);
+  free(out);
+  free(qs);
+  free(counts);
+}
+
+/* Keys 0..n-1 with random values, then RBAGG_QUERIES
+random ranges of each width summed by RBAgg_query and by
+RBAgg_scan, which must agree on every field */
+void bench_rbagg(int n)
+{
+  RBTree *tree;
+  RBAggSum got[TWO];
+  int i, w, *keys, *lo, widths[THREE], bad = ZERO;
+  double ns[TWO];
+  long sink = ZERO;
+  clock_t t;
+
+  keys = bench_keys(n);
+  lo = (int*) gfmalloc(RBAGG_QUERIES * sizeof(int));
+  tree = RBAgg_init();
+  for(i = ZERO; i < n; i++){
+    RBAgg_put(tree, keys[i], (long) (rand() % KB));
+  }
+  widths[ZERO] = SIXTEEN;
+  widths[ONE] = KB;
+  widths[TWO] = n / SIXTEEN + ONE;
+
+  bench_header("Range width", "Tree ns/op", "Scan ns/op",
+    "Speedup");
+  for(w = ZERO; w < THREE; w++){
+    for(i = ZERO; i < RBAGG_QUERIES; i++){
+      lo[i] = rand() % n;
+    }
+    t = clock();
+    for(i = ZERO; i < RBAGG_QUERIES; i++){
+      RBAgg_query(tree, lo[i], lo[i] + widths[w],
+        &got[ZERO]);
+      sink += got[ZERO].sum;
+    }
+    ns[ZERO] = bench_nsop(t, RBAGG_QUERIES);
+    t = clock();
+    for(i = ZERO; i < RBAGG_QUERIES; i++){
+      RBAgg_scan(tree, lo[i], lo[i] + widths[w], &got[ONE]);
+      sink -= got[ONE].sum;
+    }
+    ns[ONE] = bench_nsop(t, RBAGG_QUERIES);
+
+    for(i = ZERO; i < RBAGG_QUERIES; i++){
+      RBAgg_query(tree, lo[i], lo[i] + widths[w],
+        &got[ZERO]);
+      RBAgg_scan(tree, lo[i], lo[i] + widths[w], &got[ONE]);
+      bad += got[ZERO].count != got[ONE].count ||
+        got[ZERO].sum != got[ONE].sum ||
+        got[ZERO].min != got[ONE].min ||
+        got[ZERO].max != got[ONE].max;
+    }
+    printf("  %-14d | %-14.1f | %-14.1f | %-14.2f\n",
+      widths[w], ns[ZERO], ns[ONE], ns[ONE] / ns[ZERO]);
+  }
+  printf("\n  %d ranges where tree and scan disagree "
+    "(checksum %ld)\n", bad, sink);
+
+  RBTree_free(tree);
+  free(keys);
+  free(lo);
+}
+
+/* RBTree as a priority queue against a binary heap over
+the same stream: n pushes, then n holds (pop the smallest
+m and push a later key, m + 1 to m + 2n, as a scheduler
+does) and then popping all n. RBTree keeps keys distinct,
+so the held keys are drawn beforehand to miss the ones
+queued (at most half the range); both must then pop the
+very same keys in the same order, which is checked pop by
+pop */
+void bench_pq(int n)
+{
+  RBTree *tree;
+  int i, p, *keys, *later, *heap, *popped[TWO];
+  int size = ZERO, key, bad = -ONE;
+  double ns[TWO][THREE];
+  char *names[THREE] = {"push", "hold", "pop all"};
+  clock_t t;
+
+  keys = bench_keys(n);
+  later = (int*) gfmalloc((size_t) n * sizeof(int));
+  heap = (int*) gfmalloc((size_t) n * sizeof(int));
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, keys[i]);
+  }
+  for(i = ZERO; i < n; i++){
+    RBTree_popmin(tree, &key);
+    do {
+      later[i] = key + ONE + rand() % (TWO * n);
+    } while(RBTree_search(tree, later[i]) != tree->nil);
+    RBTree_insert(tree, later[i]);
+  }
+  RBTree_free(tree);
+
+  for(p = ZERO; p < TWO; p++){
+    tree = RBTree_init();
+    /* every key popped, hold phase then pop all */
+    popped[p] = (int*) gfmalloc((size_t) TWO * n *
+      sizeof(int));
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      if(p == ZERO){
+        RBTree_insert(tree, keys[i]);
+      }
+      else {
+        bench_heappush(heap, &size, keys[i]);
+      }
+    }
+    ns[p][ZERO] = bench_nsop(t, n);
+
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      if(p == ZERO){
+        RBTree_popmin(tree, &key);
+        RBTree_insert(tree, later[i]);
+      }
+      else {
+        key = bench_heappop(heap, &size);
+        bench_heappush(heap, &size, later[i]);
+      }
+      popped[p][i] = key;
+    }
+    ns[p][ONE] = bench_nsop(t, n);
+
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      if(p == ZERO){
+        RBTree_popmin(tree, &key);
+      }
+      else {
+        key = bench_heappop(heap, &size);
+      }
+      popped[p][n + i] = key;
+    }
+    ns[p][TWO] = bench_nsop(t, n);
+    RBTree_free(tree);
+  }
+
+  bench_header("PQ phase", "RBTree ns/op", "Heap ns/op",
+    "RB / heap");
+  for(i = ZERO; i < THREE; i++){
+    printf("  %-14s | %-14.1f | %-14.1f | %-14.2f\n",
+      names[i], ns[ZERO][i], ns[ONE][i],
+      ns[ZERO][i] / ns[ONE][i]);
+  }
+  for(i = ZERO; i < TWO * n && bad < ZERO; i++){
+    if(popped[ZERO][i] != popped[ONE][i]){
+      bad = i;
+    }
+  }
+  if(bad < ZERO){
+    printf("\n  all %d pops agree\n", TWO * n);
+  }
+  else {
+    printf("\n  pops DISAGREE first at pop %d: RBTree %d, "
+      "heap %d\n", bad, popped[ZERO][bad], popped[ONE][bad]);
+  }
+
+  free(keys);
+  free(later);
+  free(heap);
+  free(popped[ZERO]);
+  free(popped[ONE]);
+}
+
+/* Size, height and the ordered keys of an RBTree and a
+standard BST of the same n random keys, walked on one
+thread and by PAR_THREADS through par.c, by the wall
+clock; both ways must give the same answers */
+void bench_par(int n)
+{
+  RBTree *tree;
+  Node *root = NULL;
+  int i, w, *keys, *out[TWO], *end, bad = ZERO;
+  long got[TWO];
+  double start, ms[TWO];
+  char *names[FIVE] = {"RB size", "RB height",
+    "RB ordered", "BST size", "BST height"};
+
+  keys = bench_keys(n);
+  out[ZERO] = (int*) gfmalloc((size_t) n * sizeof(int));
+  out[ONE] = (int*) gfmalloc((size_t) n * sizeof(int));
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, keys[i]);
+    root = node_insert(root, keys[i]);
+  }
+
+  bench_header("Walk", "1 thread ms", "Parallel ms",
+    "Speedup");
+  for(w = ZERO; w < FIVE; w++){
+    start = bench_wall();
+    if(w == ZERO){
+      got[ZERO] = RBNode_size(tree, tree->root->left);
+    }
+    else if(w == ONE){
+      got[ZERO] = RBNode_height(tree, tree->root->left);
+    }
+    else if(w == TWO){
+      end = out[ZERO];
+      RBNode_getordered(tree, tree->root->left, &end);
+      got[ZERO] = end - out[ZERO];
+    }
+    else if(w == THREE){
+      got[ZERO] = node_size(root);
+    }
+    else {
+      got[ZERO] = node_height(root);
+    }
+    ms[ZERO] = (bench_wall() - start) * 1e3;
+
+    start = bench_wall();
+    if(w == ZERO){
+      got[ONE] = RBTree_sizepar(tree, PAR_THREADS);
+    }
+    else if(w == ONE){
+      got[ONE] = RBTree_heightpar(tree, PAR_THREADS);
+    }
+    else if(w == TWO){
+      RBTree_getorderedpar(tree, out[ONE], PAR_THREADS);
+      got[ONE] = n;
+    }
+    else if(w == THREE){
+      got[ONE] = node_sizepar(root, PAR_THREADS);
+    }
+    else {
+      got[ONE] = node_heightpar(root, PAR_THREADS);
+    }
+    ms[ONE] = (bench_wall() - start) * 1e3;
+
+    bad += got[ZERO] != got[ONE];
+    if(w == TWO){
+      bad += memcmp(out[ZERO], out[ONE], (size_t) n *
+        sizeof(int)) != ZERO;
+    }
+    printf("  %-14s | %-14.2f | %-14.2f | %-14.2f\n",
+      names[w], ms[ZERO], ms[ONE], ms[ZERO] / ms[ONE]);
+  }
+  printf("\n  %d threads, %d answers differ\n", PAR_THREADS,
+    bad);
+
+  RBTree_free(tree);
+  std_free(root);
+  free(keys);
+  free(out[ZERO]);
+  free(out[ONE]);
+}
+
+/* n keys, caller frees each and the array: URL-like, which
+share long prefixes ("https://www." and the host), or
+random lowercase words of 3 to STRK_WORD letters as in a
+dictionary. Either may repeat a key */
+char** bench_words(int n, bool urls)
+{
+  char *hosts[STRK_HOSTS] = {"google", "youtube",
+    "facebook", "wikipedia", "amazon", "reddit", "yahoo",
+    "twitter", "instagram", "linkedin", "netflix", "bing",
+    "github", "microsoft", "apple", "ebay"};
+  char **keys, word[TWO][STRK_WORD + ONE], buf[BUFSIZ];
+  int i, w, c, len;
+
+  keys = (char**) gfmalloc((size_t) n * sizeof(char*));
+  for(i = ZERO; i < n; i++){
+    for(w = ZERO; w < TWO; w++){
+      len = THREE + rand() % (STRK_WORD - TWO);
+      for(c = ZERO; c < len; c++){
+        word[w][c] = (char) ('a' + rand() % 26);
+      }
+      word[w][len] = '\0';
+    }
+    if(urls){
+      sprintf(buf, "https://www.%s.com/%s/%s?id=%d",
+        hosts[rand() % STRK_HOSTS], word[ZERO], word[ONE],
+        rand() % 1000000);
+    }
+    else {
+      strcpy(buf, word[ZERO]);
+    }
+    keys[i] = (char*) gfmalloc(strlen(buf) + ONE);
+    strcpy(keys[i], buf);
+  }
+  return keys;
+}
+
+/* RBStr's inline prefixes against strcmp through a
+pointer (RBStrPtr, as bst.c does it) on both key sets:
+insert, then look up every key in another order. Bytes/key
+is the node and the key text, leaving out malloc's own
+overhead on RBStrPtr's keys */
+void bench_strkey(int n)
+{
+  StrTree *st;
+  RBStrPtr *pt;
+  RBStr_node *x;
+  RBStrPtr_node *y;
+  char **keys, *names[TWO] = {"URL", "Dict"};
+  char label[SIXTEEN];
+  int set, i, *q, hits = ZERO, bad = ZERO;
+  long text;
+  double ns[TWO][TWO], bytes[TWO];
+  clock_t t;
+
+  q = bench_keys(n);
+  bench_header("Keys", "Insert ns/op", "Lookup ns/op",
+    "Bytes/key");
+  for(set = ZERO; set < TWO; set++){
+    keys = bench_words(n, set == ZERO);
+
+    t = clock();
+    pt = RBStrPtr_init();
+    for(i = ZERO; i < n; i++){
+      RBStrPtr_add(pt, keys[i]);
+    }
+    ns[ZERO][ZERO] = bench_nsop(t, n);
+    t = clock();
+    st = StrTree_init();
+    for(i = ZERO; i < n; i++){
+      StrTree_insert(st, keys[i]);
+    }
+    ns[ONE][ZERO] = bench_nsop(t, n);
+
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += RBStrPtr_search(pt, keys[q[i]]) != NULL;
+    }
+    ns[ZERO][ONE] = bench_nsop(t, n);
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += StrTree_search(st, keys[q[i]]);
+    }
+    ns[ONE][ONE] = bench_nsop(t, n);
+
+    /* the same keys in the same order */
+    text = ZERO;
+    bad += pt->size != st->tree->size;
+    y = RBStrPtr_first(pt);
+    for(x = RBStr_first(st->tree); x != NULL && y != NULL;
+      x = RBStr_next(x)){
+      bad += strcmp(x->key.str, y->key) != ZERO;
+      text += (long) strlen(y->key) + ONE;
+      y = RBStrPtr_next(y);
+    }
+    bytes[ZERO] = sizeof(RBStrPtr_node) + (double) text /
+      pt->size;
+    bytes[ONE] = sizeof(RBStr_node) + (double) st->bytes /
+      st->tree->size;
+
+    for(i = ZERO; i < TWO; i++){
+      sprintf(label, "%s %s", names[set],
+        i == ZERO ? "strcmp" : "prefix");
+      printf("  %-14s | %-14.1f | %-14.1f | %-14.1f\n",
+        label, ns[i][ZERO], ns[i][ONE], bytes[i]);
+    }
+    RBStrPtr_freekeys(pt);
+    StrTree_free(st);
+    for(i = ZERO; i < n; i++){
+      free(keys[i]);
+    }
+    free(keys);
+  }
+  printf("\n  %d keys differ between the trees, %d of %d "
+    "found\n", bad, hits, TWO * TWO * n);
+  free(q);
+}
+
+/* ART against the standard BST and RBTree on the dense
+keys ext.c uses (a shuffle of 0..n-1) and on sparse keys
+spread over all the ints: insert, a lookup of every key in
+another order, height and bytes per key. The BSTs count
+their nodes; ART counts every node and leaf it allocated */
+void bench_art(int n)
+{
+  Node *root;
+  RBTree *tree;
+  ART *art;
+  int set, i, *keys, *q, hits = ZERO, height[THREE];
+  char *sets[TWO] = {"Dense", "Sparse"};
+  char *names[THREE] = {"BST", "RB", "ART"};
+  char label[SIXTEEN];
+  double ins[THREE], get[THREE], bytes[THREE];
+  clock_t t;
+
+  q = bench_keys(n);
+  printf("\n  %-12s | %-12s | %-12s | %-12s | %-12s\n",
+    "Keys", "Insert ns/op", "Get ns/op", "Height",
+    "Bytes/key");
+  printf("  %-12s | %-12s | %-12s | %-12s | %-12s\n",
+    "------------", "------------", "------------",
+    "------------", "------------");
+  for(set = ZERO; set < TWO; set++){
+    keys = bench_keys(n);
+    if(set == ONE){
+      for(i = ZERO; i < n; i++){
+        keys[i] = (int) (((unsigned int) rand() << ONE) ^
+          (unsigned int) rand());
+      }
+    }
+
+    t = clock();
+    root = NULL;
+    for(i = ZERO; i < n; i++){
+      root = node_insert(root, keys[i]);
+    }
+    ins[ZERO] = bench_nsop(t, n);
+    t = clock();
+    tree = RBTree_init();
+    for(i = ZERO; i < n; i++){
+      RBTree_insert(tree, keys[i]);
+    }
+    ins[ONE] = bench_nsop(t, n);
+    t = clock();
+    art = ART_init();
+    for(i = ZERO; i < n; i++){
+      ART_insert(art, keys[i]);
+    }
+    ins[TWO] = bench_nsop(t, n);
+
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += node_search(root, keys[q[i]]);
+    }
+    get[ZERO] = bench_nsop(t, n);
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += RBTree_search(tree, keys[q[i]]) != tree->nil;
+    }
+    get[ONE] = bench_nsop(t, n);
+    t = clock();
+    for(i = ZERO; i < n; i++){
+      hits += ART_search(art, keys[q[i]]);
+    }
+    get[TWO] = bench_nsop(t, n);
+
+    height[ZERO] = node_height(root);
+    height[ONE] = RBNode_height(tree, tree->root->left);
+    height[TWO] = ART_height(art);
+    bytes[ZERO] = sizeof(Node);
+    bytes[ONE] = sizeof(RBNode);
+    bytes[TWO] = (double) art->bytes / art->size;
+    for(i = ZERO; i < THREE; i++){
+      sprintf(label, "%s %s", sets[set], names[i]);
+      printf("  %-12s | %-12.1f | %-12.1f | %-12d | %-12.1f\n",
+        label, ins[i], get[i], height[i], bytes[i]);
+    }
+    std_free(root);
+    RBTree_free(tree);
+    ART_free(art);
+    free(keys);
+  }
+  printf("\n  %d of %d found\n", hits, SIX * n);
+  free(q);
+}
+
+/* Durable inserts through RBWal at several group commit
+sizes against RBTree with no log. Each batch size runs at
+most WAL_SYNCS commits' worth of inserts so that batch 1,
+an fsync per insert, ends in time. Reopen is RBWal_open
+loading the snapshot and replaying the log afterwards, and
+the last tree reopened is then compacted. Times are wall
+clock, as fsync waits without using the CPU */
+void bench_wal(int n)
+{
+  RBWal *w;
+  RBTree *tree;
+  int b, i, ops, *keys, bad = ZERO;
+  int batches[FIVE] = {1, 8, 64, 512, 4096};
+  double ins, reopen, start;
+  clock_t t;
+
+  keys = bench_keys(n);
+  t = clock();
+  tree = RBTree_init();
+  for(i = ZERO; i < n; i++){
+    RBTree_insert(tree, keys[i]);
+  }
+  ins = bench_nsop(t, n);
+  RBTree_free(tree);
+
+  bench_header("Batch", "Insert ns/op", "Inserts/fsync",
+    "Reopen ns/key");
+  printf("  %-14s | %-14.1f | %-14s | %-14s\n", "No log", ins,
+    "-", "-");
+  for(b = ZERO; b < FIVE; b++){
+    ops = n;
+    if((long) batches[b] * WAL_SYNCS < ops){
+      ops = batches[b] * WAL_SYNCS;
+    }
+    RBWal_remove(WAL_BENCH);
+    start = bench_wall();
+    w = RBWal_open(WAL_BENCH, batches[b]);
+    for(i = ZERO; i < ops; i++){
+      RBWal_insert(w, keys[i]);
+    }
+    RBWal_commit(w);
+    ins = (bench_wall() - start) * 1e9 / ops;
+    printf("  %-14d | %-14.1f | %-14.1f | ", batches[b], ins,
+      (double) ops / w->syncs);
+    RBWal_close(w);
+
+    start = bench_wall();
+    w = RBWal_open(WAL_BENCH, batches[b]);
+    reopen = (bench_wall() - start) * 1e9 / ops;
+    printf("%-14.1f\n", reopen);
+    bad += w->size != ops;
+    if(b == FIVE - ONE){
+      start = bench_wall();
+      RBWal_compact(w);
+      printf("\n  %d keys compacted in %.1f ms\n", ops,
+        (bench_wall() - start) * 1e3);
+    }
+    RBWal_close(w);
+  }
+  RBWal_remove(WAL_BENCH);
+  printf("  %d reopened trees the wrong size\n", bad);
+  free(keys);
+}
@@ -3,11 +3,72 @@
 /*********************************************************/
 
 #include "bst.h"
+#include <pthread.h>
 
 #define ZERO 0
 #define ONE 1
 #define TWO 2
 #define THREE 3
+/* lookups in flight in bst_isinbatch */
+#define BST_BATCH 16
+/* scapegoat alpha = 2/3 for bst_insertsg, as sgtree.c */
+#define BST_ALPHA_NUM 2
+#define BST_ALPHA_DEN 3
+/* path kept on the stack up to this depth */
+#define BST_PATH 64
+/* first size of the growable print buffer and stacks */
+#define BST_CHUNK 64
+/* subtrees per thread in the parallel walks, and what
+their jobs compute */
+#define BST_GRAIN 8
+#define BST_PSIZE 0
+#define BST_PDEPTH 1
+#define BST_PORDER 2
+
+/* Where bstnode_stream writes: fp, or when fp is NULL a
+heap string that doubles as it fills */
+struct bstout {
+  FILE*   fp;
+  char*   buf;
+  size_t  len;
+  size_t  cap;
+};
+typedef struct bstout bstout;
+
+/* One piece of a parallel walk, in order: a subtree at the
+cut (whole) or a node above it alone, and what its job
+found; offset is its first slot in bst_getorderedpar's v */
+struct bstpar {
+  bstnode*  node;
+  int       depth;
+  bool      whole;
+  int       size;
+  int       depth_below;
+  int       offset;
+};
+typedef struct bstpar bstpar;
+
+/* A parallel walk; threads take items from next on */
+struct bstwalk {
+  bst*      b;
+  bstpar*   items;
+  int       count;
+  int       op;
+  void*     v;
+  int       next;
+};
+typedef struct bstwalk bstwalk;
+
+/* bst_validate's stack: node with the data its own must
+lie strictly between, NULL for no bound */
+struct bstcheck {
+  bstnode*  node;
+  void*     lo;
+  void*     hi;
+};
+typedef struct bstcheck bstcheck;
+/* faults bst_validate describes before going quiet */
+#define BST_REPORT 16
 
 /* BST.H NODE-VERSION PROTOTYPES  ************************/
 bstnode*  bstnode_init(int sz, void* v);
@@ -32,6 +93,10 @@ void      bst_printpreorder(bst* b);
 void      bst_printpostorder(bst* b);
 void      bst_printlevelorder(bst* b);
 void      print_voidarray(bst* b, void* v, int n);
+int       bst_halpha(int n);
+bool      bst_popend(bst* b, void* out, bool max);
+void      bst_walkpar(bst* b, bstwalk* w, int op,
+            int threads);
 
 /* BST NODE HELPER PROTOTYPES ****************************/
 void*     gfmalloc(size_t size);
@@ -45,8 +110,19 @@ void      bstnode_printinorder(bst* b, bstnode* node);
 void      bstnode_printpreorder(bst* b, bstnode* node);
 void      bstnode_printpostorder(bst* b, bstnode* node);
 void      bstnode_printlevelorder(bst* b, bstnode* node);
-void      bstnode_printgivenlevel(bst* b, bstnode* node,
-            int depth);
+int       bstnode_sizeiter(bstnode* node);
+bstnode*  bstnode_rebuild(bstnode* node, int size);
+void      bstout_puts(bstout* out, const char* str);
+void      bstnode_stream(bst* b, bstnode* node,
+            bstout* out);
+bstnode*  bstnode_buildbalanced(bstnode** v, int start,
+            int end);
+void      bstnode_frontier(bstwalk* w, bstnode* node,
+            int depth, int cut);
+void      bstwalk_run(bstwalk* w, int threads);
+void*     bstwalk_worker(void* arg);
+void      bstnode_gather(bstnode* node, bstnode** dst);
+int       bstnode_maxdepthiter(bstnode* node);
 
 /*********************************************************/
 /* BST.H FUNCTIONS ***************************************/
@@ -110,6 +186,7 @@ int bst_maxdepth(bst* b)
 tree */
 void bst_insertarray(bst* b, void* v, int n)
 {
+  bstfinger f = {NULL, NULL, NULL};
   int i;
 
   if(b == NULL){
@@ -122,9 +199,11 @@ void bst_insertarray(bst* b, void* v, int n)
     ON_ERROR("Size of array to bst_insertarray is <= 0\n");
   }
   /* No way to make sure that n is correct and that the
-  pointer arithmetic doesn't go out of bounds */
+  pointer arithmetic doesn't go out of bounds. Same tree as
+  bst_insert each item, but a sorted run goes in at the
+  finger rather than down the chain it builds */
   for(i = ZERO; i < n; i++){
-    bst_insert(b, v);
+    bst_insertfinger(b, v, &f);
     /* force in cast to char* to do pointer arithmetic */
     v = (void*)((char*) v + (size_t) b->elsz);
   }
@@ -275,6 +354,816 @@ void print_voidarray(bst* b, void* v, int n)
   }
 }
 
+/* Whether each of the n items in v is in the tree, as
+bst_isin but with up to BST_BATCH descents interleaved.
+Each level costs two dependent loads (the node then its
+data), so a lookup alternates between prefetching the data
+of the node it is on and comparing against it, and while
+one lookup waits the others make progress */
+void bst_isinbatch(bst* b, void* v, int n, bool* out)
+{
+  bstnode* cur[BST_BATCH];
+  int idx[BST_BATCH];
+  bool loaded[BST_BATCH];
+  int s, cmp, next = ZERO, active = ZERO;
+  void* item;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_isinbatch is NULL\n");
+  }
+  if(v == NULL || out == NULL){
+    ON_ERROR("V to bst_isinbatch is NULL\n");
+  }
+
+  for(s = ZERO; s < BST_BATCH; s++){
+    idx[s] = -ONE;
+    if(next < n){
+      idx[s] = next++;
+      cur[s] = b->top;
+      loaded[s] = false;
+      active++;
+    }
+  }
+
+  while(active > ZERO){
+    for(s = ZERO; s < BST_BATCH; s++){
+      if(idx[s] < ZERO){
+        continue;
+      }
+      item = (void*)((char*) v + (size_t) idx[s] * b->elsz);
+      if(cur[s] != NULL && !loaded[s]){
+        /* node is in cache by now, fetch its data */
+        __builtin_prefetch(cur[s]->data);
+        loaded[s] = true;
+        continue;
+      }
+      cmp = ZERO;
+      if(cur[s] != NULL){
+        cmp = b->compare(item, cur[s]->data);
+      }
+      if(cur[s] == NULL || cmp == ZERO){
+        out[idx[s]] = cur[s] != NULL;
+        if(next < n){
+          idx[s] = next++;
+          cur[s] = b->top;
+          loaded[s] = false;
+        }
+        else {
+          idx[s] = -ONE;
+          active--;
+        }
+        continue;
+      }
+      if(cmp < ZERO){
+        cur[s] = cur[s]->left;
+      }
+      else {
+        cur[s] = cur[s]->right;
+      }
+      __builtin_prefetch(cur[s]);
+      loaded[s] = false;
+    }
+  }
+}
+
+/* MAP MODE **********************************************/
+/* The tree becomes a map when each element is a key
+followed by its value (elsz covers both) and b->compare
+looks at the key part only. The functions below then
+return a node's stored element so the value can be read or
+changed in place, with one descent per call. */
+
+/* Stored element equal to v, adding a copy of v first if
+there is none (*inserted says which) */
+void* bst_upsert(bst* b, void* v, bool* inserted)
+{
+  bstnode** node_ptr;
+  int cmp;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_upsert is NULL\n");
+  }
+  if(v == NULL){
+    ON_ERROR("V to bst_upsert is NULL\n");
+  }
+
+  node_ptr = &b->top;
+  while(*node_ptr != NULL){
+    cmp = b->compare(v, (*node_ptr)->data);
+    if(cmp == ZERO){
+      *inserted = false;
+      return (*node_ptr)->data;
+    }
+    if(cmp < ZERO){
+      node_ptr = bstnode_getleftaddress(node_ptr);
+    }
+    else {
+      node_ptr = bstnode_getrightaddress(node_ptr);
+    }
+  }
+  *node_ptr = bstnode_init(b->elsz, v);
+  *inserted = true;
+
+  return (*node_ptr)->data;
+}
+
+/* Stored element equal to v, or NULL */
+void* bst_get(bst* b, void* v)
+{
+  bstnode* node;
+  int cmp;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_get is NULL\n");
+  }
+  if(v == NULL){
+    ON_ERROR("V to bst_get is NULL\n");
+  }
+
+  node = b->top;
+  while(node != NULL){
+    cmp = b->compare(v, node->data);
+    if(cmp == ZERO){
+      return node->data;
+    }
+    if(cmp < ZERO){
+      node = node->left;
+    }
+    else {
+      node = node->right;
+    }
+  }
+  return NULL;
+}
+
+/* Insert v, or overwrite the stored element equal to it
+(i.e. replace the value under an existing key) */
+void bst_put(bst* b, void* v)
+{
+  void* data;
+  bool inserted;
+
+  data = bst_upsert(b, v, &inserted);
+  if(!inserted){
+    memcpy(data, v, (size_t) b->elsz);
+  }
+}
+
+/* FINGER INSERT *****************************************/
+/* Inserting through a finger remembers where the last item
+went and its neighbours in order. An item that falls
+between them, as the next one of a sorted run up or down
+does, starts its descent at the finger instead of the
+root: one step for a run, where bst_insert would walk the
+whole chain the run makes. Anything else descends from the
+root as usual and the finger follows it. The neighbours
+are only right while every insert goes through the same
+finger, start a new one after any other change. */
+
+/* The finger's node is still where the descent for its
+data ends, with pred and succ the bounds met on the way,
+as they were left by the last insert through it. O(depth),
+so it is not run on every insert but left to callers and
+testbst.c; a finger whose node was freed cannot be told
+apart, only one whose neighbours have moved */
+bool bst_fingerfresh(bst* b, bstfinger* f)
+{
+  bstnode *node = b->top, *lo = NULL, *hi = NULL;
+  int cmp;
+
+  if(f->node == NULL){
+    return true;
+  }
+  while(node != NULL && node != f->node){
+    cmp = b->compare(f->node->data, node->data);
+    if(cmp < ZERO){
+      hi = node;
+      node = node->left;
+    }
+    else {
+      lo = node;
+      node = node->right;
+    }
+  }
+  return node == f->node && lo == f->pred && hi == f->succ;
+}
+
+/* Insert 1 item from the finger; false if v was already
+there */
+bool bst_insertfinger(bst* b, void* v, bstfinger* f)
+{
+  bstnode **link, *lo = NULL, *hi = NULL;
+  int cmp;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_insertfinger is NULL\n");
+  }
+  if(v == NULL){
+    ON_ERROR("V to bst_insertfinger is NULL\n");
+  }
+  if(f == NULL){
+    ON_ERROR("Finger to bst_insertfinger is NULL\n");
+  }
+
+  link = &b->top;
+  if(f->node != NULL &&
+    (f->pred == NULL || b->compare(v, f->pred->data) > ZERO)
+    && (f->succ == NULL ||
+    b->compare(v, f->succ->data) < ZERO)){
+    /* not a link in the tree, but the loop steps off it
+    before anything is written */
+    link = &f->node;
+    lo = f->pred;
+    hi = f->succ;
+  }
+  while(*link != NULL){
+    cmp = b->compare(v, (*link)->data);
+    if(cmp == ZERO){
+      return false;
+    }
+    if(cmp < ZERO){
+      hi = *link;
+      link = bstnode_getleftaddress(link);
+    }
+    else {
+      lo = *link;
+      link = bstnode_getrightaddress(link);
+    }
+  }
+  *link = bstnode_init(b->elsz, v);
+  f->node = *link;
+  f->pred = lo;
+  f->succ = hi;
+
+  return true;
+}
+
+/* PRIORITY QUEUE ****************************************/
+/* The smallest and largest items, and taking them out, so
+the tree can serve as a double-ended priority queue. The
+bst struct has no room to cache the two ends (RBTree does,
+see RBTree_peekmin), so each call walks down the left or
+right spine: O(depth), and the unlink itself is O(1) as
+the end node has at most one child. */
+
+/* Stored smallest element, NULL when empty */
+void* bst_peekmin(bst* b)
+{
+  bstnode* node;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_peekmin is NULL\n");
+  }
+  if(b->top == NULL){
+    return NULL;
+  }
+  node = b->top;
+  while(node->left != NULL){
+    node = node->left;
+  }
+  return node->data;
+}
+
+/* Stored largest element, NULL when empty */
+void* bst_peekmax(bst* b)
+{
+  bstnode* node;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_peekmax is NULL\n");
+  }
+  if(b->top == NULL){
+    return NULL;
+  }
+  node = b->top;
+  while(node->right != NULL){
+    node = node->right;
+  }
+  return node->data;
+}
+
+/* Remove the smallest item, copying it to out; false if
+the tree is empty */
+bool bst_popmin(bst* b, void* out)
+{
+  return bst_popend(b, out, false);
+}
+
+bool bst_popmax(bst* b, void* out)
+{
+  return bst_popend(b, out, true);
+}
+
+/* Unlink the last node down the left (or right) spine,
+its one child takes its place */
+bool bst_popend(bst* b, void* out, bool max)
+{
+  bstnode **link, *node;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_popend is NULL\n");
+  }
+  if(out == NULL){
+    ON_ERROR("Out to bst_popend is NULL\n");
+  }
+  if(b->top == NULL){
+    return false;
+  }
+
+  link = &b->top;
+  while((max ? (*link)->right : (*link)->left) != NULL){
+    if(max){
+      link = bstnode_getrightaddress(link);
+    }
+    else {
+      link = bstnode_getleftaddress(link);
+    }
+  }
+  node = *link;
+  *link = max ? node->left : node->right;
+  memcpy(out, node->data, (size_t) b->elsz);
+  value_free(&node->data);
+  free(node);
+
+  return true;
+}
+
+/* PARALLEL WALKS ****************************************/
+/* bst_size, bst_maxdepth and bst_getordered spread over
+threads, fork-join: the tree is cut at the depth leaving
+BST_GRAIN subtrees per thread, the subtrees below the cut
+are the jobs and the few nodes above it are taken one at a
+time. Threads take the next job free, so the load evens
+out however lopsided the subtrees are. getordered runs the
+sizes first and uses them to give each job the slot its
+nodes start at; the threads only gather node pointers, and
+b->prntnode, which may well print into one static buffer,
+is called for them in order on the caller's thread after
+the join. So only the walk of bst_getorderedpar is
+parallel; the formatting, most of its work, is not. The
+jobs walk with their own stacks, as a subtree of a
+degenerate tree is as deep as the tree and a thread's
+call stack is small. */
+
+int bst_sizepar(bst* b, int threads)
+{
+  bstwalk w;
+  int i, size = ZERO;
+
+  bst_walkpar(b, &w, BST_PSIZE, threads);
+  for(i = ZERO; i < w.count; i++){
+    size += w.items[i].size;
+  }
+  free(w.items);
+
+  return size;
+}
+
+int bst_maxdepthpar(bst* b, int threads)
+{
+  bstwalk w;
+  int i, depth = ZERO;
+
+  bst_walkpar(b, &w, BST_PDEPTH, threads);
+  for(i = ZERO; i < w.count; i++){
+    if(w.items[i].depth + w.items[i].depth_below > depth){
+      depth = w.items[i].depth + w.items[i].depth_below;
+    }
+  }
+  free(w.items);
+
+  return depth;
+}
+
+/* As bst_getordered, v must have room for every item */
+void bst_getorderedpar(bst* b, void* v, int threads)
+{
+  bstwalk w;
+  bstnode** nodes;
+  int i, offset = ZERO;
+
+  if(v == NULL){
+    ON_ERROR("V to bst_getorderedpar is NULL\n");
+  }
+  bst_walkpar(b, &w, BST_PSIZE, threads);
+  for(i = ZERO; i < w.count; i++){
+    w.items[i].offset = offset;
+    offset += w.items[i].size;
+  }
+  nodes = (bstnode**) gfmalloc(((size_t) offset + ONE) *
+    sizeof(bstnode*));
+  w.op = BST_PORDER;
+  w.v = nodes;
+  w.next = ZERO;
+  bstwalk_run(&w, threads);
+  free(w.items);
+
+  for(i = ZERO; i < offset; i++){
+    sprintf(v, "%s", b->prntnode(nodes[i]->data));
+    v = (void*) ((char*) v + (size_t) b->elsz);
+  }
+  free(nodes);
+}
+
+/* Cut the tree into w->items and run op on all of them, the
+caller frees w->items */
+void bst_walkpar(bst* b, bstwalk* w, int op, int threads)
+{
+  int cut = ZERO;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_walkpar is NULL\n");
+  }
+  if(threads <= ZERO){
+    ON_ERROR("Threads to bst_walkpar is <= 0\n");
+  }
+  while((ONE << cut) < threads * BST_GRAIN){
+    cut++;
+  }
+  w->b = b;
+  w->items = (bstpar*) gfmalloc(sizeof(bstpar) *
+    ((size_t) TWO << cut));
+  w->count = ZERO;
+  w->op = op;
+  w->v = NULL;
+  w->next = ZERO;
+  bstnode_frontier(w, b->top, ZERO, cut);
+  bstwalk_run(w, threads);
+}
+
+/* INCREMENTAL REBALANCE *********************************/
+/* bst_rebalance rebuilds the whole tree at once. Inserting
+with bst_insertsg instead keeps the tree balanced as it
+goes, scapegoat style: when a new node lands deeper than
+log_{3/2}(n) the lowest ancestor holding more than 2/3 of
+its subtree on one side is found and only that subtree is
+rebuilt, relinking the nodes already there. Rebuild work
+is O(log n) amortised per insert and a degenerate tree
+built by bst_insert is pulled into shape by the inserts
+that follow. The bst struct has no room for a count, so
+the caller keeps n, the number of items, and passes it in
+(see the prototype for what that asks of the caller). */
+
+/* Deepest a node may sit in an alpha-balanced tree of n,
+floor(log_{3/2}(n)) */
+int bst_halpha(int n)
+{
+  double p = ONE;
+  int h = ZERO;
+
+  while(p * BST_ALPHA_DEN / BST_ALPHA_NUM <= n){
+    p = p * BST_ALPHA_DEN / BST_ALPHA_NUM;
+    h++;
+  }
+  return h;
+}
+
+/* Insert 1 item, rebuilding a subtree if it went in too
+deep; false (and *n unchanged) if v was already there */
+bool bst_insertsg(bst* b, void* v, int* n)
+{
+  bstnode *local[BST_PATH], **path = local, **grown;
+  bstnode **link, *child, *w, *sibling;
+  int depth = ZERO, cap = BST_PATH, i, cmp;
+  int childsize, wsize;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_insertsg is NULL\n");
+  }
+  if(v == NULL){
+    ON_ERROR("V to bst_insertsg is NULL\n");
+  }
+
+  /* descend remembering the path, there are no parent
+  pointers */
+  link = &b->top;
+  while(*link != NULL){
+    cmp = b->compare(v, (*link)->data);
+    if(cmp == ZERO){
+      if(path != local){
+        free(path);
+      }
+      return false;
+    }
+    if(depth == cap){
+      grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+        sizeof(bstnode*));
+      memcpy(grown, path, (size_t) cap * sizeof(bstnode*));
+      if(path != local){
+        free(path);
+      }
+      path = grown;
+      cap *= TWO;
+    }
+    path[depth++] = *link;
+    if(cmp < ZERO){
+      link = bstnode_getleftaddress(link);
+    }
+    else {
+      link = bstnode_getrightaddress(link);
+    }
+  }
+  *link = bstnode_init(b->elsz, v);
+  (*n)++;
+
+  /* too deep, sizes are counted on the way back up, only
+  the sibling subtrees are walked */
+  if(depth > bst_halpha(*n)){
+    child = *link;
+    childsize = ONE;
+    for(i = depth - ONE; i >= ZERO; i--){
+      w = path[i];
+      if(w->left == child){
+        sibling = w->right;
+      }
+      else {
+        sibling = w->left;
+      }
+      wsize = childsize + bstnode_sizeiter(sibling) + ONE;
+      if(BST_ALPHA_DEN * childsize > BST_ALPHA_NUM * wsize){
+        w = bstnode_rebuild(w, wsize);
+        if(i == ZERO){
+          b->top = w;
+        }
+        else if(path[i - ONE]->left == path[i]){
+          path[i - ONE]->left = w;
+        }
+        else {
+          path[i - ONE]->right = w;
+        }
+        break;
+      }
+      child = w;
+      childsize = wsize;
+    }
+  }
+  if(path != local){
+    free(path);
+  }
+  return true;
+}
+
+/* As bstnode_size, but with its own stack, as a sibling on
+the way up from a deep insert may itself be a long chain */
+int bstnode_sizeiter(bstnode* node)
+{
+  bstnode **stack, **grown;
+  int size = ZERO, top = ZERO, cap = BST_CHUNK;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  stack = (bstnode**) gfmalloc((size_t) cap *
+    sizeof(bstnode*));
+  stack[top++] = node;
+  while(top > ZERO){
+    /* room for the two pushes below */
+    if(top + TWO > cap){
+      grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+        sizeof(bstnode*));
+      memcpy(grown, stack, (size_t) top * sizeof(bstnode*));
+      free(stack);
+      stack = grown;
+      cap *= TWO;
+    }
+    node = stack[--top];
+    size++;
+    if(node->left != NULL){
+      stack[top++] = node->left;
+    }
+    if(node->right != NULL){
+      stack[top++] = node->right;
+    }
+  }
+  free(stack);
+
+  return size;
+}
+
+/* Relink the size nodes under node as a perfectly balanced
+subtree. The in-order walk uses its own stack, so a
+degenerate subtree does not run out of call stack */
+bstnode* bstnode_rebuild(bstnode* node, int size)
+{
+  bstnode **v, **stack, *x = node;
+  int i = ZERO, top = ZERO;
+
+  v = (bstnode**) gfmalloc((size_t) size *
+    sizeof(bstnode*));
+  stack = (bstnode**) gfmalloc((size_t) size *
+    sizeof(bstnode*));
+  while(x != NULL || top > ZERO){
+    while(x != NULL){
+      stack[top++] = x;
+      x = x->left;
+    }
+    x = stack[--top];
+    v[i++] = x;
+    x = x->right;
+  }
+  node = bstnode_buildbalanced(v, ZERO, size - ONE);
+  free(stack);
+  free(v);
+
+  return node;
+}
+
+/* As bstnode_insertsortedarray, but relinking nodes rather
+than copying data */
+bstnode* bstnode_buildbalanced(bstnode** v, int start,
+  int end)
+{
+  int mid;
+
+  if(start > end){
+    return NULL;
+  }
+  mid = (start + end) / TWO;
+  v[mid]->left = bstnode_buildbalanced(v, start, mid - ONE);
+  v[mid]->right = bstnode_buildbalanced(v, mid + ONE, end);
+
+  return v[mid];
+}
+
+/* STREAMING PRINT ***************************************/
+
+/* As bst_print, but written straight to fp, so a tree of
+millions of nodes can be dumped without building the string
+in memory */
+void bst_fprint(bst* b, FILE* fp)
+{
+  bstout out;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_fprint is NULL\n");
+  }
+  if(fp == NULL){
+    ON_ERROR("FP to bst_fprint is NULL\n");
+  }
+
+  out.fp = fp;
+  out.buf = NULL;
+  out.len = out.cap = ZERO;
+  bstnode_stream(b, b->top, &out);
+}
+
+void bstout_puts(bstout* out, const char* str)
+{
+  size_t len;
+
+  if(out->fp != NULL){
+    fputs(str, out->fp);
+    return;
+  }
+  len = strlen(str);
+  if(out->len + len + ONE > out->cap){
+    while(out->len + len + ONE > out->cap){
+      out->cap *= TWO;
+    }
+    out->buf = (char*) realloc(out->buf, out->cap);
+    if(out->buf == NULL){
+      ON_ERROR("Realloc failed\n");
+    }
+  }
+  memcpy(out->buf + out->len, str, len + ONE);
+  out->len += len;
+}
+
+/* Pre-order walk with its own stack, each node is pushed
+twice: once to open it (write "(" and its data, then push
+its close, right and left) and once to close it (write
+")"). O(n) in total, prntnode is called once per node and
+a degenerate tree does not run out of call stack */
+void bstnode_stream(bst* b, bstnode* node, bstout* out)
+{
+  bstnode **stack, **grown;
+  bool *open, *grownopen;
+  int top = ZERO, cap = BST_CHUNK;
+
+  if(node == NULL){
+    return;
+  }
+  stack = (bstnode**) gfmalloc((size_t) cap *
+    sizeof(bstnode*));
+  open = (bool*) gfmalloc((size_t) cap * sizeof(bool));
+  stack[top] = node;
+  open[top++] = true;
+
+  while(top > ZERO){
+    /* room for the three pushes below */
+    if(top + THREE > cap){
+      grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+        sizeof(bstnode*));
+      grownopen = (bool*) gfmalloc((size_t) cap * TWO *
+        sizeof(bool));
+      memcpy(grown, stack, (size_t) top * sizeof(bstnode*));
+      memcpy(grownopen, open, (size_t) top * sizeof(bool));
+      free(stack);
+      free(open);
+      stack = grown;
+      open = grownopen;
+      cap *= TWO;
+    }
+    node = stack[--top];
+    if(!open[top]){
+      bstout_puts(out, ")");
+      continue;
+    }
+    bstout_puts(out, "(");
+    bstout_puts(out, b->prntnode(node->data));
+    stack[top] = node;
+    open[top++] = false;
+    if(node->right != NULL){
+      stack[top] = node->right;
+      open[top++] = true;
+    }
+    if(node->left != NULL){
+      stack[top] = node->left;
+      open[top++] = true;
+    }
+  }
+  free(stack);
+  free(open);
+}
+
+/* VALIDATION ********************************************/
+
+/* Check order and node count in one pass with its own
+stack (so a degenerate tree is fine). n is the number of
+items the caller believes are in the tree, e.g. the count
+kept for bst_insertsg, or < 0 to skip that check. The first
+BST_REPORT faults are described on fp (may be NULL) and the
+number found is returned, 0 for a good tree. A node out of
+order is not gone into, so a corrupt tree that loops back
+on itself still ends */
+int bst_validate(bst* b, int n, FILE* fp)
+{
+  bstcheck *stack, *grown, f;
+  int top = ZERO, cap = BST_CHUNK, errors = ZERO;
+  int count = ZERO;
+
+  if(b == NULL){
+    ON_ERROR("BST to bst_validate is NULL\n");
+  }
+
+  stack = (bstcheck*) gfmalloc((size_t) cap *
+    sizeof(bstcheck));
+  stack[top].node = b->top;
+  stack[top].lo = stack[top].hi = NULL;
+  top++;
+
+  while(top > ZERO){
+    f = stack[--top];
+    if(f.node == NULL){
+      continue;
+    }
+    if(f.node->data == NULL){
+      if(fp != NULL && errors < BST_REPORT){
+        fprintf(fp, "node with NULL data\n");
+      }
+      errors++;
+      continue;
+    }
+    if((f.lo != NULL &&
+      b->compare(f.node->data, f.lo) <= ZERO) ||
+      (f.hi != NULL &&
+      b->compare(f.node->data, f.hi) >= ZERO)){
+      if(fp != NULL && errors < BST_REPORT){
+        fprintf(fp, "order: %s out of place\n",
+          b->prntnode(f.node->data));
+      }
+      errors++;
+      continue;
+    }
+    count++;
+
+    if(top + TWO > cap){
+      grown = (bstcheck*) gfmalloc((size_t) cap * TWO *
+        sizeof(bstcheck));
+      memcpy(grown, stack, (size_t) top * sizeof(bstcheck));
+      free(stack);
+      stack = grown;
+      cap *= TWO;
+    }
+    stack[top].node = f.node->left;
+    stack[top].lo = f.lo;
+    stack[top++].hi = f.node->data;
+    stack[top].node = f.node->right;
+    stack[top].lo = f.node->data;
+    stack[top++].hi = f.hi;
+  }
+  free(stack);
+
+  if(n >= ZERO && count != n){
+    if(fp != NULL && errors < BST_REPORT){
+      fprintf(fp, "size: %d nodes, expected %d\n", count,
+        n);
+    }
+    errors++;
+  }
+  return errors;
+}
+
 /*********************************************************/
 /* BST.H NODE-VERSION FUNCTIONS **************************/
 /*********************************************************/
@@ -401,35 +1290,24 @@ void bstnode_free(bstnode** node_ptr)
   *node_ptr = NULL;
 }
 
+/* The (head(left)(right)) string is written in one pass
+into a single growing buffer, see bstnode_stream */
 char* bstnode_print(bst* b, bstnode* node)
 {
-  char *str_l, *str_r, *str_node, *str;
-  int len_l, len_r, len_node;
+  bstout out;
 
   if(b == NULL){
     ON_ERROR("BST to bstnode_print is NULL");
   }
 
-  if(node == NULL){
-    return str = (char*) gfcalloc((size_t) ONE,
-      sizeof(char));
-  }
-  str_l = bstnode_print(b, node->left);
-  str_r = bstnode_print(b, node->right);
-  str_node = b->prntnode(node->data);
-  len_l = strlen(str_l);
-  len_r = strlen(str_r);
-  len_node = strlen(b->prntnode(node->data));
-
-  /* THREE because two brackets and null character */
-  str = (char*) gfmalloc((size_t) len_l + len_r + len_node
-    + THREE);
-  sprintf(str, "(%s%s%s)", str_node, str_l, str_r);
+  out.fp = NULL;
+  out.cap = BST_CHUNK;
+  out.len = ZERO;
+  out.buf = (char*) gfmalloc(out.cap);
+  out.buf[ZERO] = '\0';
+  bstnode_stream(b, node, &out);
 
-  free(str_l);
-  free(str_r);
-
-  return str;
+  return out.buf;
 }
 
 void bstnode_getordered(bst* b, bstnode* node,
@@ -593,41 +1471,204 @@ void bstnode_printpostorder(bst* b, bstnode* node)
   }
 }
 
+/* One pass with a queue (a ring buffer that doubles when
+full), right child before left within each level, in O(n)
+where going back down from the root for every level was
+O(n*h) */
 void bstnode_printlevelorder(bst* b, bstnode* node)
 {
-  int i;
-  int maxdepth;
+  bstnode **queue, **grown;
+  int head = ZERO, count = ZERO, cap = BST_CHUNK, i;
 
   if(b == NULL){
     ON_ERROR("BST to bstnode_printlevelorder is NULL\n");
   }
 
-  maxdepth = bst_maxdepth(b);
-  for(i = ONE; i <= maxdepth; i++){
-    bstnode_printgivenlevel(b, node, i);
+  if(node == NULL){
+    return;
   }
+  queue = (bstnode**) gfmalloc((size_t) cap *
+    sizeof(bstnode*));
+  queue[count++] = node;
+
+  while(count > ZERO){
+    node = queue[head];
+    head = (head + ONE) % cap;
+    count--;
+    printf("%s\n", b->prntnode(node->data));
+    if(count + TWO > cap){
+      grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+        sizeof(bstnode*));
+      for(i = ZERO; i < count; i++){
+        grown[i] = queue[(head + i) % cap];
+      }
+      free(queue);
+      queue = grown;
+      head = ZERO;
+      cap *= TWO;
+    }
+    if(node->right != NULL){
+      queue[(head + count++) % cap] = node->right;
+    }
+    if(node->left != NULL){
+      queue[(head + count++) % cap] = node->left;
+    }
+  }
+  free(queue);
 }
 
-void bstnode_printgivenlevel(bst* b, bstnode* node,
-  int depth)
+/* Items of the subtree at node, in order */
+void bstnode_frontier(bstwalk* w, bstnode* node, int depth,
+  int cut)
 {
-  if(b == NULL){
-    ON_ERROR("BST to bstnode_printgivenlevel is NULL\n");
-  }
-  if(depth <= ZERO){
-    ON_ERROR("Depth to bstnode_printgivenlevel is <= 0\n");
-  }
+  bstpar* it;
 
   if(node == NULL){
     return;
   }
-  if(depth == ONE){
-    printf("%s\n", b->prntnode(node->data));
+  if(depth < cut){
+    bstnode_frontier(w, node->left, depth + ONE, cut);
   }
-  else if(depth > ONE){
-    bstnode_printgivenlevel(b, node->right,
-      depth - ONE);
-    bstnode_printgivenlevel(b, node->left,
-      depth - ONE);
+  it = &w->items[w->count++];
+  it->node = node;
+  it->depth = depth;
+  it->whole = depth == cut;
+  it->size = it->depth_below = it->offset = ZERO;
+  if(depth < cut){
+    bstnode_frontier(w, node->right, depth + ONE, cut);
   }
 }
+
+/* The caller's thread works as one of threads */
+void bstwalk_run(bstwalk* w, int threads)
+{
+  pthread_t* tid;
+  int t;
+
+  tid = (pthread_t*) gfmalloc((size_t) threads *
+    sizeof(pthread_t));
+  for(t = ONE; t < threads; t++){
+    if(pthread_create(&tid[t], NULL, bstwalk_worker, w) !=
+      ZERO){
+      ON_ERROR("bstwalk_run could not start a thread\n");
+    }
+  }
+  bstwalk_worker(w);
+  for(t = ONE; t < threads; t++){
+    pthread_join(tid[t], NULL);
+  }
+  free(tid);
+}
+
+void* bstwalk_worker(void* arg)
+{
+  bstwalk* w = (bstwalk*) arg;
+  bstpar* it;
+  bstnode** dst;
+  int i;
+
+  while((i = __sync_fetch_and_add(&w->next, ONE)) <
+    w->count){
+    it = &w->items[i];
+    if(!it->whole){
+      it->size = it->depth_below = ONE;
+    }
+    else if(w->op == BST_PSIZE){
+      it->size = bstnode_sizeiter(it->node);
+    }
+    else if(w->op == BST_PDEPTH){
+      it->depth_below = bstnode_maxdepthiter(it->node);
+    }
+    if(w->op == BST_PORDER){
+      dst = (bstnode**) w->v + it->offset;
+      if(it->whole){
+        bstnode_gather(it->node, dst);
+      }
+      else {
+        *dst = it->node;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* The nodes under node in order, from dst on; the in-order
+walk of bstnode_rebuild, with a stack that grows */
+void bstnode_gather(bstnode* node, bstnode** dst)
+{
+  bstnode **stack, **grown;
+  int top = ZERO, cap = BST_CHUNK;
+
+  stack = (bstnode**) gfmalloc((size_t) cap *
+    sizeof(bstnode*));
+  while(node != NULL || top > ZERO){
+    while(node != NULL){
+      if(top == cap){
+        grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+          sizeof(bstnode*));
+        memcpy(grown, stack, (size_t) top *
+          sizeof(bstnode*));
+        free(stack);
+        stack = grown;
+        cap *= TWO;
+      }
+      stack[top++] = node;
+      node = node->left;
+    }
+    node = stack[--top];
+    *dst++ = node;
+    node = node->right;
+  }
+  free(stack);
+}
+
+/* As bstnode_maxdepth, with its own stack of nodes and the
+depth each is at */
+int bstnode_maxdepthiter(bstnode* node)
+{
+  bstnode **stack, **grown;
+  int *at, *grownat;
+  int top = ZERO, cap = BST_CHUNK, depth, max = ZERO;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  stack = (bstnode**) gfmalloc((size_t) cap *
+    sizeof(bstnode*));
+  at = (int*) gfmalloc((size_t) cap * sizeof(int));
+  stack[top] = node;
+  at[top++] = ONE;
+  while(top > ZERO){
+    /* room for the two pushes below */
+    if(top + TWO > cap){
+      grown = (bstnode**) gfmalloc((size_t) cap * TWO *
+        sizeof(bstnode*));
+      grownat = (int*) gfmalloc((size_t) cap * TWO *
+        sizeof(int));
+      memcpy(grown, stack, (size_t) top * sizeof(bstnode*));
+      memcpy(grownat, at, (size_t) top * sizeof(int));
+      free(stack);
+      free(at);
+      stack = grown;
+      at = grownat;
+      cap *= TWO;
+    }
+    node = stack[--top];
+    depth = at[top];
+    if(depth > max){
+      max = depth;
+    }
+    if(node->left != NULL){
+      stack[top] = node->left;
+      at[top++] = depth + ONE;
+    }
+    if(node->right != NULL){
+      stack[top] = node->right;
+      at[top++] = depth + ONE;
+    }
+  }
+  free(stack);
+  free(at);
+
+  return max;
+}
@@ -0,0 +1,87 @@
+/*********************************************************/
+/* BST.H *************************************************/
+/*********************************************************/
+
+/* Binary search tree over items of any one size: the tree
+copies each item in (elsz bytes), orders them with compare
+and prints one with prntnode. The first block is the
+assignment's interface, the second what was added on top
+of it, see bst.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define ON_ERROR(STR) fprintf(stderr, STR); \
+        exit(EXIT_FAILURE);
+
+struct bstnode {
+  void*           data;
+  struct bstnode* left;
+  struct bstnode* right;
+};
+typedef struct bstnode bstnode;
+
+struct bst {
+  bstnode*        top;
+  int             elsz;
+  int             (*compare)(const void* a, const void* b);
+  char*           (*prntnode)(const void* a);
+};
+typedef struct bst bst;
+
+bst*      bst_init(int sz,
+            int (*comp)(const void* a, const void* b),
+            char* (*prnt)(const void* a));
+void      bst_insert(bst* b, void* v);
+int       bst_size(bst* b);
+int       bst_maxdepth(bst* b);
+void      bst_insertarray(bst* b, void* v, int n);
+bool      bst_isin(bst* b, void* v);
+void      bst_free(bst** p);
+char*     bst_print(bst* b);
+void      bst_getordered(bst* b, void* v);
+bst*      bst_rebalance(bst* b);
+
+/*********************************************************/
+/* EXTENSIONS ********************************************/
+/*********************************************************/
+
+/* Last node bst_insertfinger added and its in-order
+neighbours, NULL past either end; {NULL, NULL, NULL} to
+start. The tree keeps no count of its changes, so after
+any change not made through the finger it must be set to
+{NULL, NULL, NULL} again; bst_fingerfresh checks a finger
+still holds, at the cost of a descent */
+struct bstfinger {
+  bstnode*        node;
+  bstnode*        pred;
+  bstnode*        succ;
+};
+typedef struct bstfinger bstfinger;
+
+void      bst_isinbatch(bst* b, void* v, int n, bool* out);
+void*     bst_upsert(bst* b, void* v, bool* inserted);
+void*     bst_get(bst* b, void* v);
+void      bst_put(bst* b, void* v);
+void      bst_fprint(bst* b, FILE* fp);
+int       bst_validate(bst* b, int n, FILE* fp);
+/* *n is the caller's count of the items in b, bst_size(b)
+to start with. bst_insertsg adds one for each item it puts
+in, and a rebuild trusts it, so every change to b after
+that must go through bst_insertsg with the same n (or n be
+counted again); bst_validate(b, *n, fp) checks it */
+bool      bst_insertsg(bst* b, void* v, int* n);
+bool      bst_insertfinger(bst* b, void* v, bstfinger* f);
+bool      bst_fingerfresh(bst* b, bstfinger* f);
+void*     bst_peekmin(bst* b);
+void*     bst_peekmax(bst* b);
+bool      bst_popmin(bst* b, void* out);
+bool      bst_popmax(bst* b, void* out);
+int       bst_sizepar(bst* b, int threads);
+int       bst_maxdepthpar(bst* b, int threads);
+/* Only the walk is spread over threads: b->prntnode is
+called for every item in turn on the caller's thread */
+void      bst_getorderedpar(bst* b, void* v, int threads);
@@ -0,0 +1,176 @@
+/*********************************************************/
+/* ENGINE.C **********************************************/
+/*********************************************************/
+
+/* One table of int-key tree engines behind a common set of
+function pointers, so the height table in main and the
+timing harness can loop over them rather than repeat the
+same build/measure/free code for every tree. */
+
+#include "ext.h"
+
+/*********************************************************/
+/* ADAPTERS **********************************************/
+/*********************************************************/
+
+static void* rb_init(void)
+{
+  return RBTree_init();
+}
+
+static void rb_insert(void* t, int key)
+{
+  RBTree_insert((RBTree*) t, key);
+}
+
+static bool rb_search(void* t, int key)
+{
+  RBTree *tree = (RBTree*) t;
+
+  return RBTree_search(tree, key) != tree->nil;
+}
+
+/* not counting the sentinel root that RBNode_height does
+when called on tree->root */
+static int rb_height(void* t)
+{
+  RBTree *tree = (RBTree*) t;
+
+  return RBNode_height(tree, tree->root->left);
+}
+
+static void rb_free(void* t)
+{
+  RBTree_free((RBTree*) t);
+}
+
+static void* rbtd_init(void)
+{
+  return RBTD_init();
+}
+
+static void rbtd_insert(void* t, int key)
+{
+  RBTD_insert((RBTDTree*) t, key);
+}
+
+static bool rbtd_search(void* t, int key)
+{
+  return RBTD_search((RBTDTree*) t, key) != NULL;
+}
+
+static int rbtd_height(void* t)
+{
+  return RBTD_height(((RBTDTree*) t)->root);
+}
+
+static void rbtd_free(void* t)
+{
+  RBTD_free((RBTDTree*) t);
+}
+
+static void* rbint_init(void)
+{
+  return RBInt_init();
+}
+
+static void rbint_insert(void* t, int key)
+{
+  RBInt_insert((RBInt*) t, key);
+}
+
+static bool rbint_search(void* t, int key)
+{
+  return RBInt_search((RBInt*) t, key) != NULL;
+}
+
+static int rbint_height(void* t)
+{
+  return RBInt_height(((RBInt*) t)->root);
+}
+
+static void rbint_free(void* t)
+{
+  RBInt_free((RBInt*) t);
+}
+
+/* The remaining engines share one API shape, X_init,
+X_insert, X_search, X_height and X_free */
+#define ADAPT(P, T) \
+  static void* P##_einit(void) { return P##_init(); } \
+  static void P##_einsert(void* t, int key) \
+    { P##_insert((T*) t, key); } \
+  static bool P##_esearch(void* t, int key) \
+    { return P##_search((T*) t, key); } \
+  static int P##_eheight(void* t) \
+    { return P##_height((T*) t); } \
+  static void P##_efree(void* t) { P##_free((T*) t); }
+
+#define ENTRY(NAME, P) \
+  {NAME, P##_einit, P##_einsert, P##_esearch, \
+    P##_eheight, P##_efree}
+
+ADAPT(AVL, AVLTree)
+ADAPT(Treap, Treap)
+ADAPT(Splay, SplayTree)
+ADAPT(SG, SGTree)
+ADAPT(WAVL, WAVLTree)
+ADAPT(ART, ART)
+
+/*********************************************************/
+/* ENGINE TABLE ******************************************/
+/*********************************************************/
+
+Engine* engine_table(int* n)
+{
+  static Engine engines[] = {
+    {"Red-Black", rb_init, rb_insert, rb_search, rb_height,
+      rb_free},
+    {"RB top-down", rbtd_init, rbtd_insert, rbtd_search,
+      rbtd_height, rbtd_free},
+    {"RB template", rbint_init, rbint_insert, rbint_search,
+      rbint_height, rbint_free},
+    ENTRY("AVL", AVL),
+    ENTRY("Treap", Treap),
+    ENTRY("Splay", Splay),
+    ENTRY("Scapegoat", SG),
+    ENTRY("WAVL", WAVL),
+    ENTRY("ART", ART)
+  };
+
+  *n = (int) (sizeof(engines) / sizeof(engines[ZERO]));
+  return engines;
+}
+
+/* As std_heightworst, keys inserted in order */
+int engine_heightworst(Engine* e)
+{
+  void *tree;
+  int i, height;
+
+  tree = e->init();
+  for(i = ZERO; i < N; i++){
+    e->insert(tree, i);
+  }
+  height = e->height(tree);
+  e->free(tree);
+
+  return height;
+}
+
+/* As std_heightavg, keys inserted in a random order */
+int engine_heightavg(Engine* e, int a[N])
+{
+  void *tree;
+  int i, height;
+
+  randomise(a);
+  tree = e->init();
+  for(i = ZERO; i < N; i++){
+    e->insert(tree, a[i]);
+  }
+  height = e->height(tree);
+  e->free(tree);
+
+  return height;
+}
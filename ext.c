@@ -4,7 +4,7 @@
 
 #include "ext.h"
 
-int main(void)
+int main(int argc, char* argv[])
 {
   int a[N], i;
   int std_worst, rb_worst;
@@ -12,7 +12,27 @@ int main(void)
   double std_avg, rb_avg;
   double std_worsttheo, rb_worsttheo;
   double std_avgcalc, N_d = N;
-  double std_avgtheo;
+  double std_avgtheo, std_avgexact;
+  HDist *dist;
+  Engine *engines;
+  int nengines, e, eng_sum;
+  RBTree *tree;
+  Arena *arena;
+  clock_t t, std_t = ZERO, rb_t = ZERO;
+  double std_pool, rb_pool;
+
+  /* ./ext bench ... runs the timing harness instead */
+  if(argc > ONE && strcmp(argv[ONE], "bench") == ZERO){
+    return bench_run(argc - TWO, argv + TWO);
+  }
+  /* ./ext stress ... checks the trees against each other */
+  if(argc > ONE && strcmp(argv[ONE], "stress") == ZERO){
+    return stress_run(argc - TWO, argv + TWO);
+  }
+  /* ./ext height ... exact random BST heights by DP */
+  if(argc > ONE && strcmp(argv[ONE], "height") == ZERO){
+    return hdist_run(argc - TWO, argv + TWO);
+  }
 
   srand(time(NULL));
   make_array(a);
@@ -27,8 +47,12 @@ int main(void)
 
   /* AVERAGE CASE ****************************************/
   for(i = ZERO; i < SAMPLESIZE; i++){
+    t = clock();
     std_sum = std_sum + std_heightavg(a);
+    std_t += clock() - t;
+    t = clock();
     rb_sum = rb_sum + RBTree_heightavg(a);
+    rb_t += clock() - t;
   }
   std_avg = (double) std_sum / SAMPLESIZE;
   rb_avg = (double) rb_sum / SAMPLESIZE;
@@ -36,6 +60,10 @@ int main(void)
   std_avgcalc = (N_d * N_d * N_d + SIX * N_d * N_d +
     ELEVEN * N_d + SIX) / TWENTYFOUR;
   std_avgtheo = (double) my_log((double) std_avgcalc, TWO);
+  /* and exactly, see hdist.c */
+  dist = HDist_init(N);
+  std_avgexact = HDist_mean(dist);
+  HDist_free(dist);
 
   /* PRINT TABLE *****************************************/
 
@@ -49,6 +77,8 @@ int main(void)
     "Worst", std_worst, std_worsttheo);
   printf("  %-14s | %-14.2f | %-14.2f\n",
     "Average", std_avg, std_avgtheo);
+  printf("  %-14s | %-14s | %-14.2f\n",
+    "Average exact", "", std_avgexact);
 
   printf("\n  %-14s | %-14s | %-14s\n",
     "Red-Black BST", "Computed", "Theoretical");
@@ -59,6 +89,52 @@ int main(void)
   printf("  %-14s | %-14.2f | <%-13.2f\n\n",
     "Average", rb_avg, rb_worsttheo);
 
+  /* OTHER BALANCED BSTS *********************************/
+  engines = engine_table(&nengines);
+  printf("  %-14s | %-14s | %-14s\n",
+    "Other trees", "Worst", "Average");
+  printf("  %-14s | %-14s | %-14s\n",
+    "--------------", "--------------", "--------------");
+  for(e = ZERO; e < nengines; e++){
+    eng_sum = ZERO;
+    for(i = ZERO; i < SAMPLESIZE; i++){
+      eng_sum = eng_sum + engine_heightavg(&engines[e], a);
+    }
+    printf("  %-14s | %-14d | %-14.2f\n", engines[e].name,
+      engine_heightworst(&engines[e]),
+      (double) eng_sum / SAMPLESIZE);
+  }
+
+  /* BUILD AND TEARDOWN **********************************/
+  /* The same trials again with nodes from an arena that is
+  reset, not freed node by node, between trials */
+  arena = Arena_init(ARENA_BLOCK, ZERO, ZERO);
+  t = clock();
+  for(i = ZERO; i < SAMPLESIZE; i++){
+    std_heightavgarena(a, arena);
+  }
+  std_pool = bench_secs(t) * 1e3 / SAMPLESIZE;
+  tree = RBTree_init();
+  t = clock();
+  for(i = ZERO; i < SAMPLESIZE; i++){
+    RBTree_heightavgarena(a, tree, arena);
+  }
+  rb_pool = bench_secs(t) * 1e3 / SAMPLESIZE;
+  RBTree_freeshell(tree);
+  Arena_free(arena);
+
+  printf("\n  %-14s | %-14s | %-14s\n",
+    "ms per trial", "malloc/free", "Arena reset");
+  printf("  %-14s | %-14s | %-14s\n",
+    "--------------", "--------------", "--------------");
+  printf("  %-14s | %-14.3f | %-14.3f\n", "Basic BST",
+    (double) std_t * 1e3 / CLOCKS_PER_SEC / SAMPLESIZE,
+    std_pool);
+  printf("  %-14s | %-14.3f | %-14.3f\n", "Red-Black BST",
+    (double) rb_t * 1e3 / CLOCKS_PER_SEC / SAMPLESIZE,
+    rb_pool);
+  printf("\n");
+
   return EXIT_SUCCESS;
 }
 
@@ -94,6 +170,69 @@ Node* node_insert(Node* node, int data)
   return node;
 }
 
+bool node_search(Node* node, int data)
+{
+  while(node != NULL && node->key != data){
+    if(data < node->key){
+      node = node->left;
+    }
+    else {
+      node = node->right;
+    }
+  }
+  return node != NULL;
+}
+
+/* node_insert from the finger, see RBTree_fingernode: a
+key in the gap either side of the finger's node descends
+from there and anything else from the root, so a sorted
+run costs O(1) a key however deep the chain it makes */
+Node* node_insertfinger(Node* root, NodeFinger* f, int data)
+{
+  Node *x = root, *y = NULL, *lo = NULL, *hi = NULL;
+
+  if(f->node != NULL){
+    if(data == f->node->key){
+      return root;
+    }
+    if((f->pred == NULL || data > f->pred->key) &&
+      (f->succ == NULL || data < f->succ->key)){
+      x = f->node;
+      lo = f->pred;
+      hi = f->succ;
+    }
+  }
+  while(x != NULL){
+    y = x;
+    if(data < x->key){
+      hi = x;
+      x = x->left;
+    }
+    else if(data > x->key){
+      lo = x;
+      x = x->right;
+    }
+    else {
+      return root;
+    }
+  }
+  x = node_init(data);
+  if(y == NULL){
+    root = x;
+  }
+  else if(data < y->key){
+    y->left = x;
+  }
+  else {
+    y->right = x;
+  }
+  f->node = x;
+  f->pred = lo;
+  f->succ = hi;
+
+  return root;
+}
+
 void node_printinorder(Node* node)
 {
   if(node != NULL){
@@ -129,10 +268,12 @@ int std_heightworst(void)
 {
   int i, height;
   Node *root = NULL;
+  NodeFinger f = {NULL, NULL, NULL};
 
-  root = node_insert(root, ZERO);
-  for(i = ONE; i < N; i++){
-    node_insert(root, i);
+  /* in order, so from the finger: node_insert would recur
+  down the whole chain each time */
+  for(i = ZERO; i < N; i++){
+    root = node_insertfinger(root, &f, i);
   }
 
   height = node_height(root);
@@ -168,6 +309,42 @@ void std_free(Node* node)
   free(node);
 }
 
+/* As node_insert with the new node from the arena */
+Node* node_insertarena(Node* node, int data, Arena* a)
+{
+  if(node == NULL){
+    node = (Node*) Arena_alloc(a, sizeof(Node));
+    node->key = data;
+    node->left = node->right = NULL;
+    return node;
+  }
+  if(data < node->key){
+    node->left = node_insertarena(node->left, data, a);
+  }
+  else if(data > node->key){
+    node->right = node_insertarena(node->right, data, a);
+  }
+
+  return node;
+}
+
+/* As std_heightavg, but the tree is torn down by resetting
+the arena, which keeps its memory for the next trial */
+int std_heightavgarena(int a[N], Arena* arena)
+{
+  Node *root = NULL;
+  int i, height;
+
+  randomise(a);
+  for(i = ZERO; i < N; i++){
+    root = node_insertarena(root, a[i], arena);
+  }
+  height = node_height(root);
+  Arena_reset(arena);
+
+  return height;
+}
+
 /*********************************************************/
 /* RED-BLACK BST *****************************************/
 /*********************************************************/
@@ -192,6 +369,10 @@ RBTree* RBTree_init(void)
   tmp->colour = black;
   tmp->key = ZERO;
 
+  newtree->augment = NULL;
+  newtree->min = newtree->max = newtree->nil;
+  newtree->version = ZERO;
+
   return(newtree);
 }
 
@@ -229,6 +410,11 @@ void rotate_left(RBTree* tree, RBNode* x)
   /* STEP 4 */
   y->left = x;
   x->parent = y;
+  /* x is now below y, so x first */
+  if(tree->augment != NULL){
+    tree->augment(tree, x);
+    tree->augment(tree, y);
+  }
 }
 
 void rotate_right(RBTree* tree, RBNode* y)
@@ -265,9 +451,15 @@ void rotate_right(RBTree* tree, RBNode* y)
   /* STEP 4 */
   x->right = y;
   y->parent = x;
+  if(tree->augment != NULL){
+    tree->augment(tree, y);
+    tree->augment(tree, x);
+  }
 }
 
-void RBTree_insertiter(RBTree* tree, RBNode* z)
+/* Links z in as a leaf and returns it, or returns the node
+already holding z->key and leaves z out of the tree */
+RBNode* RBTree_insertiter(RBTree* tree, RBNode* z)
 {
   RBNode *x, *y, *nil = tree->nil;
 
@@ -284,6 +476,10 @@ void RBTree_insertiter(RBTree* tree, RBNode* z)
     else if (z->key > x->key){
       x = x->right;
     }
+    /* equal key, nothing to add */
+    else {
+      return x;
+    }
   }
   /* y is then lagged version of x i.e. x's parent and
   then set z's parent to be y*/
@@ -295,20 +491,72 @@ void RBTree_insertiter(RBTree* tree, RBNode* z)
   else {
     y->right = z;
   }
+  RBTree_updateends(tree, z);
+  return z;
 }
 
 RBNode* RBTree_insert(RBTree* tree, int key)
 {
-  RBNode *uncle, *z, *newnode;
+  RBNode *z, *x;
 
-  /* init z node and standard insert into bst, set colour
-  = red */
   z = (RBNode*) gfmalloc(sizeof(RBNode));
   z->key = key;
-  RBTree_insertiter(tree, z);
-  newnode = z;
+  x = RBTree_insertnode(tree, z);
+  /* key was already there */
+  if(x != z){
+    free(z);
+  }
+  return x;
+}
+
+/* z was just linked in, it may be the new first or last */
+void RBTree_updateends(RBTree* tree, RBNode* z)
+{
+  if(tree->min == tree->nil || z->key < tree->min->key){
+    tree->min = z;
+  }
+  if(tree->max == tree->nil || z->key > tree->max->key){
+    tree->max = z;
+  }
+}
+
+/* Recompute the augmented data from x up to the real root */
+void RBTree_augmentup(RBTree* tree, RBNode* x)
+{
+  if(tree->augment == NULL){
+    return;
+  }
+  while(x != tree->root){
+    tree->augment(tree, x);
+    x = x->parent;
+  }
+}
+
+/* Insert a node the caller has allocated (it may be bigger
+than an RBNode, see RBTree.augment) with z->key set; returns
+z, or the node already holding the key with z not added */
+RBNode* RBTree_insertnode(RBTree* tree, RBNode* z)
+{
+  RBNode *newnode;
+
+  /* standard insert into bst, set colour = red */
+  newnode = RBTree_insertiter(tree, z);
+  if(newnode != z){
+    return newnode;
+  }
   z->colour = red;
+  RBTree_augmentup(tree, z);
+  RBTree_insertfixup(tree, z);
+
+  return newnode;
+}
 
+/* z is a red leaf just linked in */
+void RBTree_insertfixup(RBTree* tree, RBNode* z)
+{
+  RBNode *uncle;
+
+  tree->version++;
   /* RB Insert Fixup */
   /* Property 1 = Every node is either red or black
      Property 2 = The root is black
@@ -419,7 +667,461 @@ RBNode* RBTree_insert(RBTree* tree, int key)
     }
   }
   tree->root->left->colour = black;
-  return newnode;
+}
+
+/* A finger with no node yet, its first insert descends from
+the root */
+void RBFinger_init(RBTree* tree, RBFinger* f)
+{
+  f->node = f->pred = f->succ = tree->nil;
+  f->version = tree->version;
+}
+
+/* RBTree_insertnode starting from the finger rather than
+the root, and the finger moves to z. A key between the
+finger's node and one of its in-order neighbours (the next
+key of a sorted run, up or down) is linked in just below
+the finger with no climb: O(1) amortized with the fixup.
+Any other key climbs from the finger to the lowest
+ancestor whose subtree spans it and descends from there.
+That is O(log d) for a key d places from the finger when
+the two share a low ancestor, but a key just across a high
+one (the root, at worst) climbs to it and descends again,
+so the bound is O(log n), as from the root. The
+neighbours are remembered, so the finger only holds while
+every change goes through it: if the tree's version has
+moved on since the finger's last insert (another insert, a
+delete or a clear), the finger's nodes may be gone and the
+key descends from the root as from a new finger */
+RBNode* RBTree_fingernode(RBTree* tree, RBFinger* f,
+  RBNode* z)
+{
+  RBNode *x, *y, *lo, *hi, *nil = tree->nil;
+  int key = z->key;
+  bool up;
+
+  x = f->node;
+  lo = f->pred;
+  hi = f->succ;
+  if(f->version != tree->version){
+    x = nil;
+    lo = hi = nil;
+  }
+  if(x == nil){
+    x = tree->root->left;
+  }
+  else if(key == x->key){
+    return x;
+  }
+  /* outside the gap either side of the finger */
+  else if((lo != nil && key <= lo->key) ||
+    (hi != nil && key >= hi->key)){
+    up = key > x->key;
+    lo = hi = nil;
+    /* x's subtree spans key once x is the left child of a
+    bigger key going up, or the right of a smaller going
+    down; the bound on the far side is found descending,
+    and past the top node the whole tree spans it */
+    while(x->parent != tree->root){
+      y = x->parent;
+      if(key == y->key){
+        return y;
+      }
+      if(up && x == y->left && key < y->key){
+        hi = y;
+        break;
+      }
+      if(!up && x == y->right && key > y->key){
+        lo = y;
+        break;
+      }
+      x = y;
+    }
+  }
+
+  y = tree->root;
+  while(x != nil){
+    y = x;
+    if(key < x->key){
+      hi = x;
+      x = x->left;
+    }
+    else if(key > x->key){
+      lo = x;
+      x = x->right;
+    }
+    else {
+      return x;
+    }
+  }
+  z->left = z->right = nil;
+  z->parent = y;
+  if(y == tree->root || key < y->key){
+    y->left = z;
+  }
+  else {
+    y->right = z;
+  }
+  RBTree_updateends(tree, z);
+  z->colour = red;
+  RBTree_augmentup(tree, z);
+  RBTree_insertfixup(tree, z);
+  f->node = z;
+  f->pred = lo;
+  f->succ = hi;
+  f->version = tree->version;
+
+  return z;
+}
+
+RBNode* RBTree_insertfinger(RBTree* tree, RBFinger* f,
+  int key)
+{
+  RBNode *z, *x;
+
+  z = (RBNode*) gfmalloc(sizeof(RBNode));
+  z->key = key;
+  x = RBTree_fingernode(tree, f, z);
+  if(x != z){
+    free(z);
+  }
+  return x;
+}
+
+RBNode* RBTree_search(RBTree* tree, int key)
+{
+  RBNode *x, *nil = tree->nil;
+
+  x = tree->root->left;
+  while(x != nil && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x;
+}
+
+/* Search for k keys at once, out[i] = node for keys[i]
+(or nil). Up to RB_BATCH descents are in flight: each pass
+moves every one of them down one level and prefetches the
+child it will read next, so the cache misses of different
+keys overlap rather than queue up. A finished slot takes
+the next key straight away (AMAC). */
+void RBTree_searchbatch(RBTree* tree, int* keys, int k,
+  RBNode** out)
+{
+  RBNode *cur[RB_BATCH], *x, *root, *nil = tree->nil;
+  int idx[RB_BATCH], s, next = ZERO, active = ZERO;
+
+  root = tree->root->left;
+  for(s = ZERO; s < RB_BATCH; s++){
+    idx[s] = -ONE;
+    if(next < k){
+      idx[s] = next++;
+      cur[s] = root;
+      active++;
+    }
+  }
+
+  while(active > ZERO){
+    for(s = ZERO; s < RB_BATCH; s++){
+      if(idx[s] < ZERO){
+        continue;
+      }
+      x = cur[s];
+      if(x == nil || x->key == keys[idx[s]]){
+        out[idx[s]] = x;
+        if(next < k){
+          idx[s] = next++;
+          cur[s] = root;
+        }
+        else {
+          idx[s] = -ONE;
+          active--;
+        }
+        continue;
+      }
+      if(keys[idx[s]] < x->key){
+        x = x->left;
+      }
+      else {
+        x = x->right;
+      }
+      __builtin_prefetch(x);
+      cur[s] = x;
+    }
+  }
+}
+
+RBNode* RBTree_minimum(RBTree* tree, RBNode* x)
+{
+  while(x->left != tree->nil){
+    x = x->left;
+  }
+  return x;
+}
+
+RBNode* RBTree_maximum(RBTree* tree, RBNode* x)
+{
+  while(x->right != tree->nil){
+    x = x->right;
+  }
+  return x;
+}
+
+/* In-order successor, tree->nil after the last key */
+RBNode* RBTree_next(RBTree* tree, RBNode* x)
+{
+  RBNode *y;
+
+  if(x->right != tree->nil){
+    return RBTree_minimum(tree, x->right);
+  }
+  y = x->parent;
+  while(y != tree->root && x == y->right){
+    x = y;
+    y = y->parent;
+  }
+  /* climbed out of the real root */
+  if(y == tree->root){
+    return tree->nil;
+  }
+  return y;
+}
+
+/* In-order predecessor, tree->nil before the first key */
+RBNode* RBTree_prev(RBTree* tree, RBNode* x)
+{
+  RBNode *y;
+
+  if(x->left != tree->nil){
+    return RBTree_maximum(tree, x->left);
+  }
+  y = x->parent;
+  while(y != tree->root && x == y->left){
+    x = y;
+    y = y->parent;
+  }
+  if(y == tree->root){
+    return tree->nil;
+  }
+  return y;
+}
+
+/* Node with the smallest key >= key, or nil */
+RBNode* RBTree_lowerbound(RBTree* tree, int key)
+{
+  RBNode *x, *best, *nil = tree->nil;
+
+  best = nil;
+  x = tree->root->left;
+  while(x != nil){
+    if(x->key < key){
+      x = x->right;
+    }
+    else {
+      best = x;
+      x = x->left;
+    }
+  }
+  return best;
+}
+
+/* Put subtree v where subtree u was, u's own links are
+left alone */
+void RBNode_transplant(RBNode* u, RBNode* v)
+{
+  /* the real root is tree->root->left, so the sentinel
+  root is just another parent here */
+  if(u == u->parent->left){
+    u->parent->left = v;
+  }
+  else {
+    u->parent->right = v;
+  }
+  v->parent = u->parent;
+}
+
+bool RBTree_delete(RBTree* tree, int key)
+{
+  RBNode *z;
+
+  z = RBTree_search(tree, key);
+  if(z == tree->nil){
+    return false;
+  }
+  RBTree_deletenode(tree, z);
+
+  return true;
+}
+
+/* Unlink and free z, a node in the tree */
+void RBTree_deletenode(RBTree* tree, RBNode* z)
+{
+  RBNode *x, *y, *nil = tree->nil;
+  rdblk y_colour;
+
+  tree->version++;
+  /* the cached ends move in by one, O(1) amortized as the
+  first node has no left child and the last no right */
+  if(z == tree->min){
+    tree->min = RBTree_next(tree, z);
+  }
+  if(z == tree->max){
+    tree->max = RBTree_prev(tree, z);
+  }
+
+  /* y is the node that actually leaves its place: z
+  itself if it has at most one child, else its successor
+  which is moved (not copied) into z's place, so pointers
+  to other nodes stay valid. x is the node that moves into
+  y's old place and may carry an extra black */
+  y = z;
+  y_colour = y->colour;
+  if(z->left == nil){
+    x = z->right;
+    RBNode_transplant(z, z->right);
+  }
+  else if(z->right == nil){
+    x = z->left;
+    RBNode_transplant(z, z->left);
+  }
+  else {
+    y = RBTree_minimum(tree, z->right);
+    y_colour = y->colour;
+    x = y->right;
+    if(y->parent == z){
+      x->parent = y;
+    }
+    else {
+      RBNode_transplant(y, y->right);
+      y->right = z->right;
+      y->right->parent = y;
+    }
+    RBNode_transplant(z, y);
+    y->left = z->left;
+    y->left->parent = y;
+    y->colour = z->colour;
+  }
+  free(z);
+  /* every subtree that lost z or had y moved out of it
+  lies on the path up from x's parent */
+  RBTree_augmentup(tree, x->parent);
+
+  /* Removing a red node breaks nothing, removing a black
+  one leaves property 5 short by one black on x's paths */
+  if(y_colour == black){
+    RBTree_deletefixup(tree, x);
+  }
+}
+
+/* First node, or nil when empty, O(1) */
+RBNode* RBTree_peekmin(RBTree* tree)
+{
+  return tree->min;
+}
+
+/* Last node, or nil when empty, O(1) */
+RBNode* RBTree_peekmax(RBTree* tree)
+{
+  return tree->max;
+}
+
+/* Remove the smallest key into *key, false when empty */
+bool RBTree_popmin(RBTree* tree, int* key)
+{
+  if(tree->min == tree->nil){
+    return false;
+  }
+  *key = tree->min->key;
+  RBTree_deletenode(tree, tree->min);
+
+  return true;
+}
+
+/* Remove the largest key into *key, false when empty */
+bool RBTree_popmax(RBTree* tree, int* key)
+{
+  if(tree->max == tree->nil){
+    return false;
+  }
+  *key = tree->max->key;
+  RBTree_deletenode(tree, tree->max);
+
+  return true;
+}
+
+void RBTree_deletefixup(RBTree* tree, RBNode* x)
+{
+  RBNode *w;
+
+  while(x != tree->root->left && x->colour == black){
+    if(x == x->parent->left){
+      w = x->parent->right;
+      /* red sibling, rotate so the sibling is black */
+      if(w->colour == red){
+        w->colour = black;
+        x->parent->colour = red;
+        rotate_left(tree, x->parent);
+        w = x->parent->right;
+      }
+      /* black sibling with black children, take a black
+      off both and move the problem up */
+      if(w->left->colour == black &&
+        w->right->colour == black){
+        w->colour = red;
+        x = x->parent;
+      }
+      else {
+        /* sibling's far child black, rotate its red near
+        child up first */
+        if(w->right->colour == black){
+          w->left->colour = black;
+          w->colour = red;
+          rotate_right(tree, w);
+          w = x->parent->right;
+        }
+        /* sibling's far child red, one rotation ends it */
+        w->colour = x->parent->colour;
+        x->parent->colour = black;
+        w->right->colour = black;
+        rotate_left(tree, x->parent);
+        x = tree->root->left;
+      }
+    }
+    /* SYMMETRIC TO ABOVE */
+    else {
+      w = x->parent->left;
+      if(w->colour == red){
+        w->colour = black;
+        x->parent->colour = red;
+        rotate_right(tree, x->parent);
+        w = x->parent->left;
+      }
+      if(w->right->colour == black &&
+        w->left->colour == black){
+        w->colour = red;
+        x = x->parent;
+      }
+      else {
+        if(w->left->colour == black){
+          w->right->colour = black;
+          w->colour = red;
+          rotate_left(tree, w);
+          w = x->parent->left;
+        }
+        w->colour = x->parent->colour;
+        x->parent->colour = black;
+        w->left->colour = black;
+        rotate_right(tree, x->parent);
+        x = tree->root->left;
+      }
+    }
+  }
+  x->colour = black;
 }
 
 int RBNode_height(RBTree *tree, RBNode* z)
@@ -447,14 +1149,16 @@ int RBNode_height(RBTree *tree, RBNode* z)
 int RBTree_heightworst(void)
 {
   RBTree *tree;
+  RBFinger f;
   int i, height;
 
-  /* Create & print RED-BLACK BST */
+  /* Create & print RED-BLACK BST, appending at the finger */
   tree = RBTree_init();
+  RBFinger_init(tree, &f);
   for(i = ZERO; i < N; i++){
-    RBTree_insert(tree, i);
+    RBTree_insertfinger(tree, &f, i);
   }
-  height = RBNode_height(tree, tree->root);
+  height = RBNode_height(tree, tree->root->left);
   RBTree_free(tree);
 
   return height;
@@ -470,12 +1174,31 @@ int RBTree_heightavg(int a[N])
   for(i = ZERO; i < N; i++){
     RBTree_insert(tree, a[i]);
   }
-  height = RBNode_height(tree, tree->root);
+  height = RBNode_height(tree, tree->root->left);
   RBTree_free(tree);
 
   return height;
 }
 
+/* As RBTree_heightavg, reusing tree and arena: the tree is
+emptied with RBTree_clear and its nodes go with one
+Arena_reset rather than a free() each */
+int RBTree_heightavgarena(int a[N], RBTree* tree,
+  Arena* arena)
+{
+  int i, height;
+
+  randomise(a);
+  for(i = ZERO; i < N; i++){
+    Arena_rbinsert(arena, tree, a[i]);
+  }
+  height = RBNode_height(tree, tree->root->left);
+  RBTree_clear(tree);
+  Arena_reset(arena);
+
+  return height;
+}
+
 void RBTree_free(RBTree* tree)
 {
   RBTree_recur(tree, tree->root->left);
@@ -484,6 +1207,25 @@ void RBTree_free(RBTree* tree)
   free(tree);
 }
 
+/* The tree's own parts but none of its nodes, for nodes
+that belong to something else (an Arena) */
+void RBTree_freeshell(RBTree* tree)
+{
+  free(tree->root);
+  free(tree->nil);
+  free(tree);
+}
+
+/* Empty the tree without visiting its nodes, for when
+something else (an Arena) owns them */
+void RBTree_clear(RBTree* tree)
+{
+  tree->root->left = tree->nil;
+  tree->nil->parent = tree->nil;
+  tree->min = tree->max = tree->nil;
+  tree->version++;
+}
+
 void RBTree_recur(RBTree* tree, RBNode* x)
 {
   RBNode* nil = tree->nil;
@@ -495,6 +1237,131 @@ void RBTree_recur(RBTree* tree, RBNode* x)
   }
 }
 
+/* Check the whole tree from scratch: the sentinels,
+properties 1-5 listed in RBTree_insert, key order and
+parent pointers, in one pass with its own stack so that
+even a degenerate tree is fine. Faults are described on fp
+(may be NULL) and counted, 0 is a good tree. A child whose
+parent pointer is wrong, or a node whose two children are
+the same, is reported and not gone into, so a corrupt tree
+with a cycle in it still ends */
+int RBTree_validate(RBTree* tree, FILE* fp)
+{
+  RBCheck *stack, *grown, f;
+  RBNode *x, *c, *nil = tree->nil;
+  int top = ZERO, cap = SIXTEEN, errors = ZERO, bh = -ONE;
+  int blacks, i;
+  bool bhbad = false;
+
+  if(nil->colour != black){
+    validate_report(fp, errors++, "nil is not black\n");
+  }
+  x = tree->root->left;
+  if(x != nil && x->parent != tree->root){
+    validate_report(fp, errors++,
+      "root %d parent is not the sentinel\n", x->key);
+  }
+  if(x->colour != black){
+    validate_report(fp, errors++,
+      "property 2: root %d is red\n", x->key);
+  }
+
+  stack = (RBCheck*) gfmalloc((size_t) cap *
+    sizeof(RBCheck));
+  stack[top].node = x;
+  stack[top].lo = (long) INT_MIN - ONE;
+  stack[top].hi = (long) INT_MAX + ONE;
+  stack[top++].blacks = ZERO;
+
+  while(top > ZERO){
+    f = stack[--top];
+    x = f.node;
+    /* all paths must reach nil through as many blacks */
+    if(x == nil){
+      if(bh < ZERO){
+        bh = f.blacks;
+      }
+      /* one fault however many paths it shows on */
+      else if(f.blacks != bh && !bhbad){
+        validate_report(fp, errors++, "property 5: black "
+          "height %d and %d\n", bh, f.blacks);
+        bhbad = true;
+      }
+      continue;
+    }
+    if(x->colour != black && x->colour != red){
+      validate_report(fp, errors++,
+        "property 1: node %d colour %d\n", x->key,
+        (int) x->colour);
+    }
+    if(x->key <= f.lo || x->key >= f.hi){
+      validate_report(fp, errors++, "order: key %d "
+        "outside (%ld, %ld)\n", x->key, f.lo, f.hi);
+    }
+    if(x->colour == red && (x->left->colour == red ||
+      x->right->colour == red)){
+      validate_report(fp, errors++,
+        "property 4: red node %d has a red child\n",
+        x->key);
+    }
+    if(x->left == x->right && x->left != nil){
+      validate_report(fp, errors++,
+        "node %d has the same left and right child\n",
+        x->key);
+      continue;
+    }
+
+    blacks = f.blacks + (x->colour == black);
+    if(top + TWO > cap){
+      grown = (RBCheck*) gfmalloc((size_t) cap * TWO *
+        sizeof(RBCheck));
+      memcpy(grown, stack, (size_t) top * sizeof(RBCheck));
+      free(stack);
+      stack = grown;
+      cap *= TWO;
+    }
+    for(i = ZERO; i < TWO; i++){
+      c = i == ZERO ? x->left : x->right;
+      if(c != nil && c->parent != x){
+        validate_report(fp, errors++,
+          "parent: child %d of %d points back at %d\n",
+          c->key, x->key,
+          c->parent == nil ? -ONE : c->parent->key);
+        continue;
+      }
+      stack[top].node = c;
+      stack[top].lo = i == ZERO ? f.lo : x->key;
+      stack[top].hi = i == ZERO ? x->key : f.hi;
+      stack[top++].blacks = blacks;
+    }
+  }
+  free(stack);
+
+  /* the cached ends, once the tree itself is sound */
+  if(errors == ZERO && (tree->min != RBTree_minimum(tree,
+    tree->root->left) || tree->max != RBTree_maximum(tree,
+    tree->root->left))){
+    validate_report(fp, errors++,
+      "ends: min or max is not the first or last node\n");
+  }
+  return errors;
+}
+
+/* Describe fault number errors (from 0) on fp, the first
+RB_REPORT only */
+void validate_report(FILE* fp, int errors, const char* fmt,
+  ...)
+{
+  va_list args;
+
+  if(fp == NULL || errors >= RB_REPORT){
+    return;
+  }
+  va_start(args, fmt);
+  vfprintf(fp, fmt, args);
+  va_end(args);
+}
+
 /*********************************************************/
 /* MISC **************************************************/
 /*********************************************************/
@@ -9,6 +9,11 @@
 #include <assert.h>
 #include <time.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <pthread.h>
+#include "rbtmpl.h"
 
 #define ON_ERROR(STR) fprintf(stderr, STR); \
         exit(EXIT_FAILURE);
@@ -17,8 +22,13 @@
 #define ZERO 0
 #define ONE 1
 #define TWO 2
+#define THREE 3
+#define FOUR 4
+#define FIVE 5
 #define SIX 6
+#define SEVEN 7
 #define ELEVEN 11
+#define SIXTEEN 16
 #define TWENTYFOUR 24
 
 /*********************************************************/
@@ -32,8 +42,22 @@ struct node {
 };
 typedef struct node Node;
 
+/* Last node inserted through the finger and its in-order
+neighbours (NULL past either end). Node keeps no count of
+its changes, so the finger must be zeroed again after the
+tree is changed other than through it */
+struct nodefinger {
+  Node*          node;
+  Node*          pred;
+  Node*          succ;
+};
+typedef struct nodefinger NodeFinger;
+
 Node*     node_init(int data);
 Node*     node_insert(Node* node, int data);
+bool      node_search(Node* node, int data);
+Node*     node_insertfinger(Node* root, NodeFinger* f,
+            int data);
 void      node_printinorder(Node* node);
 int       node_height(Node *node);
 int       std_heightworst(void);
@@ -44,6 +68,11 @@ void      std_free(Node* node);
 /* RED-BLACK BST *****************************************/
 /*********************************************************/
 
+/* descents in flight in RBTree_searchbatch */
+#define RB_BATCH 16
+/* faults RBTree_validate describes before going quiet */
+#define RB_REPORT 16
+
 enum rdblk {black, red};
 typedef enum rdblk rdblk;
 
@@ -56,22 +85,1065 @@ struct rbnode {
 };
 typedef struct rbnode RBNode;
 
+/* augment, when set, recomputes whatever x keeps about its
+subtree from x and its children; it is called bottom-up on
+every node whose subtree changes (see RBTree_augmentup).
+min and max are the first and last node, nil when empty.
+version counts the changes to the tree's shape, so a finger
+can tell it has gone stale (see RBTree_fingernode) */
 struct rbtree {
   RBNode*        nil;
   RBNode*        root;
+  void           (*augment)(struct rbtree* tree, RBNode* x);
+  RBNode*        min;
+  RBNode*        max;
+  unsigned long  version;
 };
 typedef struct rbtree RBTree;
 
+/* RBTree_validate's stack: node with the open interval
+(lo, hi) its key must lie in and the black nodes above */
+struct rbcheck {
+  RBNode*        node;
+  long           lo;
+  long           hi;
+  int            blacks;
+};
+typedef struct rbcheck RBCheck;
+
+/* Last node inserted through the finger and its in-order
+neighbours (nil past either end), and the tree's version
+once that insert was done, see RBTree_insertfinger */
+struct rbfinger {
+  RBNode*        node;
+  RBNode*        pred;
+  RBNode*        succ;
+  unsigned long  version;
+};
+typedef struct rbfinger RBFinger;
+
 RBTree*   RBTree_init(void);
 void      rotate_left(RBTree* tree, RBNode* x);
 void      rotate_right(RBTree* tree, RBNode* y);
-void      RBTree_insertiter(RBTree* tree, RBNode* z);
+RBNode*   RBTree_insertiter(RBTree* tree, RBNode* z);
+RBNode*   RBTree_insertnode(RBTree* tree, RBNode* z);
 RBNode*   RBTree_insert(RBTree* tree, int key);
+void      RBTree_updateends(RBTree* tree, RBNode* z);
+void      RBTree_insertfixup(RBTree* tree, RBNode* z);
+void      RBFinger_init(RBTree* tree, RBFinger* f);
+RBNode*   RBTree_fingernode(RBTree* tree, RBFinger* f,
+            RBNode* z);
+RBNode*   RBTree_insertfinger(RBTree* tree, RBFinger* f,
+            int key);
+void      RBTree_augmentup(RBTree* tree, RBNode* x);
+RBNode*   RBTree_search(RBTree* tree, int key);
+void      RBTree_searchbatch(RBTree* tree, int* keys, int k,
+            RBNode** out);
+RBNode*   RBTree_minimum(RBTree* tree, RBNode* x);
+RBNode*   RBTree_maximum(RBTree* tree, RBNode* x);
+RBNode*   RBTree_next(RBTree* tree, RBNode* x);
+RBNode*   RBTree_prev(RBTree* tree, RBNode* x);
+RBNode*   RBTree_lowerbound(RBTree* tree, int key);
+void      RBNode_transplant(RBNode* u, RBNode* v);
+bool      RBTree_delete(RBTree* tree, int key);
+void      RBTree_deletenode(RBTree* tree, RBNode* z);
+RBNode*   RBTree_peekmin(RBTree* tree);
+RBNode*   RBTree_peekmax(RBTree* tree);
+bool      RBTree_popmin(RBTree* tree, int* key);
+bool      RBTree_popmax(RBTree* tree, int* key);
+void      RBTree_deletefixup(RBTree* tree, RBNode* x);
 int       RBNode_height(RBTree *tree, RBNode* z);
 int       RBTree_heightworst(void);
 int       RBTree_heightavg(int a[N]);
 void      RBTree_free(RBTree* tree);
 void      RBTree_recur(RBTree* tree, RBNode* x);
+void      RBTree_freeshell(RBTree* tree);
+void      RBTree_clear(RBTree* tree);
+int       RBTree_validate(RBTree* tree, FILE* fp);
+void      validate_report(FILE* fp, int errors,
+            const char* fmt, ...);
+
+/*********************************************************/
+/* INDEX RED-BLACK BST ***********************************/
+/*********************************************************/
+
+/* Nodes are addressed by index into tree->pool, index 0 is
+nil and the top bit of parent is the colour (set = red) */
+#define RBIDX_NIL 0
+#define RBIDX_RED 0x80000000u
+#define RBIDX_MASK 0x7fffffffu
+
+struct rbidxnode {
+  int            key;
+  uint32_t       parent;
+  uint32_t       left;
+  uint32_t       right;
+};
+typedef struct rbidxnode RBIdxNode;
+
+struct rbidxtree {
+  RBIdxNode*     pool;
+  uint32_t       size;
+  uint32_t       cap;
+  uint32_t       root;
+};
+typedef struct rbidxtree RBIdxTree;
+
+RBIdxTree* RBIdx_init(uint32_t cap);
+uint32_t  RBIdx_newnode(RBIdxTree* tree, int key);
+void      RBIdx_setparent(RBIdxTree* tree, uint32_t x,
+            uint32_t p);
+void      RBIdx_replace(RBIdxTree* tree, uint32_t x,
+            uint32_t y);
+void      RBIdx_rotateleft(RBIdxTree* tree, uint32_t x);
+void      RBIdx_rotateright(RBIdxTree* tree, uint32_t y);
+uint32_t  RBIdx_insert(RBIdxTree* tree, int key);
+uint32_t  RBIdx_search(RBIdxTree* tree, int key);
+int       RBIdx_height(RBIdxTree* tree, uint32_t x);
+size_t    RBIdx_bytes(RBIdxTree* tree);
+void      RBIdx_save(RBIdxTree* tree, FILE* fp);
+RBIdxTree* RBIdx_load(FILE* fp);
+void      RBIdx_free(RBIdxTree* tree);
+
+/*********************************************************/
+/* TOP-DOWN RED-BLACK BST ********************************/
+/*********************************************************/
+
+/* No parent pointer, children indexed by direction */
+#define LEFT 0
+#define RIGHT 1
+
+struct rbtdnode {
+  rdblk            colour;
+  int              key;
+  struct rbtdnode* link[2];
+};
+typedef struct rbtdnode RBTDNode;
+
+struct rbtdtree {
+  RBTDNode*      root;
+};
+typedef struct rbtdtree RBTDTree;
+
+RBTDTree* RBTD_init(void);
+RBTDNode* RBTD_newnode(int key);
+bool      RBTD_isred(RBTDNode* node);
+RBTDNode* RBTD_single(RBTDNode* root, int dir);
+RBTDNode* RBTD_double(RBTDNode* root, int dir);
+bool      RBTD_insert(RBTDTree* tree, int key);
+bool      RBTD_delete(RBTDTree* tree, int key);
+RBTDNode* RBTD_search(RBTDTree* tree, int key);
+int       RBTD_height(RBTDNode* node);
+void      RBTD_free(RBTDTree* tree);
+void      RBTD_recur(RBTDNode* node);
+
+/*********************************************************/
+/* TEMPLATE RED-BLACK BST ********************************/
+/*********************************************************/
+
+/* See rbtmpl.h, functions are written out in rbint.c */
+DECLARE_RBTREE(RBInt, int);
+
+/* int -> long map from the same template, see rbmap.c */
+DECLARE_RBMAP(RBMap, int, long);
+
+/*********************************************************/
+/* AVL BST ***********************************************/
+/*********************************************************/
+
+struct avlnode {
+  int              key;
+  int              height;
+  struct avlnode*  left;
+  struct avlnode*  right;
+};
+typedef struct avlnode AVLNode;
+
+struct avltree {
+  AVLNode*       root;
+};
+typedef struct avltree AVLTree;
+
+AVLTree*  AVL_init(void);
+int       AVLNode_h(AVLNode* node);
+void      AVLNode_update(AVLNode* node);
+AVLNode*  AVLNode_rotleft(AVLNode* x);
+AVLNode*  AVLNode_rotright(AVLNode* y);
+AVLNode*  AVLNode_insert(AVLNode* node, int key);
+void      AVL_insert(AVLTree* tree, int key);
+bool      AVL_search(AVLTree* tree, int key);
+int       AVL_height(AVLTree* tree);
+void      AVL_free(AVLTree* tree);
+void      AVL_recur(AVLNode* node);
+
+/*********************************************************/
+/* TREAP *************************************************/
+/*********************************************************/
+
+struct treapnode {
+  int                key;
+  int                prio;
+  struct treapnode*  left;
+  struct treapnode*  right;
+};
+typedef struct treapnode TreapNode;
+
+struct treap {
+  TreapNode*     root;
+};
+typedef struct treap Treap;
+
+Treap*    Treap_init(void);
+TreapNode* TreapNode_rotleft(TreapNode* x);
+TreapNode* TreapNode_rotright(TreapNode* y);
+TreapNode* TreapNode_insert(TreapNode* node, int key);
+void      Treap_insert(Treap* tree, int key);
+bool      Treap_search(Treap* tree, int key);
+int       TreapNode_height(TreapNode* node);
+int       Treap_height(Treap* tree);
+void      Treap_free(Treap* tree);
+void      Treap_recur(TreapNode* node);
+
+/*********************************************************/
+/* SPLAY BST *********************************************/
+/*********************************************************/
+
+struct splaynode {
+  int                key;
+  struct splaynode*  left;
+  struct splaynode*  right;
+};
+typedef struct splaynode SplayNode;
+
+struct splaytree {
+  SplayNode*     root;
+  int            size;
+};
+typedef struct splaytree SplayTree;
+
+SplayTree* Splay_init(void);
+SplayNode* SplayNode_splay(SplayNode* t, int key);
+void      Splay_insert(SplayTree* tree, int key);
+bool      Splay_search(SplayTree* tree, int key);
+int       Splay_height(SplayTree* tree);
+void      Splay_free(SplayTree* tree);
+
+/*********************************************************/
+/* SCAPEGOAT BST *****************************************/
+/*********************************************************/
+
+/* alpha = NUM/DEN, MAXDEPTH bounds log_{1/alpha}(INT_MAX) */
+#define SG_ALPHA_NUM 2
+#define SG_ALPHA_DEN 3
+#define SG_MAXDEPTH 128
+
+struct sgnode {
+  int            key;
+  struct sgnode* left;
+  struct sgnode* right;
+};
+typedef struct sgnode SGNode;
+
+struct sgtree {
+  SGNode*        root;
+  int            size;
+};
+typedef struct sgtree SGTree;
+
+SGTree*   SG_init(void);
+int       SG_halpha(int n);
+int       SGNode_size(SGNode* node);
+void      SGNode_flatten(SGNode* node, SGNode** v, int* i);
+SGNode*   SGNode_build(SGNode** v, int start, int end);
+SGNode*   SGNode_rebuild(SGNode* node, int size);
+void      SG_insert(SGTree* tree, int key);
+bool      SG_search(SGTree* tree, int key);
+int       SGNode_height(SGNode* node);
+int       SG_height(SGTree* tree);
+void      SG_free(SGTree* tree);
+void      SG_recur(SGNode* node);
+
+/*********************************************************/
+/* WAVL BST **********************************************/
+/*********************************************************/
+
+struct wavlnode {
+  int              key;
+  int              rank;
+  struct wavlnode* left;
+  struct wavlnode* right;
+};
+typedef struct wavlnode WAVLNode;
+
+struct wavltree {
+  WAVLNode*      root;
+};
+typedef struct wavltree WAVLTree;
+
+WAVLTree* WAVL_init(void);
+int       WAVLNode_rank(WAVLNode* node);
+WAVLNode* WAVLNode_fixleft(WAVLNode* x);
+WAVLNode* WAVLNode_fixright(WAVLNode* x);
+WAVLNode* WAVLNode_insert(WAVLNode* x, int key);
+void      WAVL_insert(WAVLTree* tree, int key);
+WAVLNode* WAVLNode_delfixleft(WAVLNode* x);
+WAVLNode* WAVLNode_delfixright(WAVLNode* x);
+WAVLNode* WAVLNode_delete(WAVLNode* x, int key,
+            bool* found);
+bool      WAVL_delete(WAVLTree* tree, int key);
+bool      WAVL_search(WAVLTree* tree, int key);
+int       WAVLNode_height(WAVLNode* node);
+int       WAVL_height(WAVLTree* tree);
+void      WAVL_free(WAVLTree* tree);
+void      WAVL_recur(WAVLNode* node);
+
+/*********************************************************/
+/* ADAPTIVE RADIX TREE ***********************************/
+/*********************************************************/
+
+/* bytes in a key, and so the most levels there can be */
+#define ART_KEYLEN 8
+#define ART_MAX48 48
+/* ARTNode type */
+#define ART_LEAF 0
+#define ART_4 1
+#define ART_16 2
+#define ART_48 3
+#define ART_256 4
+
+/* Head of every node kind and of ARTLeaf; prefix holds the
+prefixlen bytes skipped before this node branches */
+struct artnode {
+  unsigned char  type;
+  unsigned char  prefixlen;
+  unsigned short count;
+  unsigned char  prefix[ART_KEYLEN];
+};
+typedef struct artnode ARTNode;
+
+struct artleaf {
+  ARTNode        n;
+  uint64_t       key;
+};
+typedef struct artleaf ARTLeaf;
+
+struct artnode4 {
+  ARTNode        n;
+  unsigned char  keys[FOUR];
+  ARTNode*       child[FOUR];
+};
+typedef struct artnode4 ARTNode4;
+
+struct artnode16 {
+  ARTNode        n;
+  unsigned char  keys[SIXTEEN];
+  ARTNode*       child[SIXTEEN];
+};
+typedef struct artnode16 ARTNode16;
+
+/* index[b] is 1 + the slot of byte b's child, 0 for none */
+struct artnode48 {
+  ARTNode        n;
+  unsigned char  index[UCHAR_MAX + ONE];
+  ARTNode*       child[ART_MAX48];
+};
+typedef struct artnode48 ARTNode48;
+
+struct artnode256 {
+  ARTNode        n;
+  ARTNode*       child[UCHAR_MAX + ONE];
+};
+typedef struct artnode256 ARTNode256;
+
+/* bytes is everything allocated, leaves included */
+struct art {
+  ARTNode*       root;
+  int            size;
+  long           bytes;
+};
+typedef struct art ART;
+
+ART*      ART_init(void);
+uint64_t  ART_intkey(int key);
+int       ART_keyint(uint64_t key);
+void      ART_keybytes(uint64_t key, unsigned char* kb);
+ARTNode*  ART_newnode(ART* t, unsigned char type);
+size_t    ART_nodesize(unsigned char type);
+ARTNode** ART_findchild(ARTNode* n, unsigned char b);
+void      ART_addchild(ART* t, ARTNode** ref, unsigned char b,
+            ARTNode* child);
+ARTNode*  ART_grow(ART* t, ARTNode* n);
+bool      ART_insert64(ART* t, uint64_t key);
+bool      ART_insertat(ART* t, ARTNode** ref, uint64_t key,
+            unsigned char* kb, int depth);
+ARTNode*  ART_newleaf(ART* t, uint64_t key);
+bool      ART_search64(ART* t, uint64_t key);
+void      ART_insert(ART* t, int key);
+bool      ART_search(ART* t, int key);
+void      ART_getordered(ART* t, uint64_t* out);
+void      ARTNode_getordered(ARTNode* n, uint64_t** out);
+int       ART_height(ART* t);
+int       ARTNode_height(ARTNode* n);
+void      ART_free(ART* t);
+void      ARTNode_free(ARTNode* n);
+
+/*********************************************************/
+/* RED-BLACK LOOKUP CACHE ********************************/
+/*********************************************************/
+
+/* 2^32 / golden ratio, for Fibonacci hashing */
+#define RBCACHE_PHI 2654435769u
+#define RBCACHE_WORD 32
+
+/* node == NULL marks an empty slot, tree->nil a cached
+miss */
+struct rbcacheslot {
+  int            key;
+  RBNode*        node;
+};
+typedef struct rbcacheslot RBCacheSlot;
+
+struct rbcache {
+  RBTree*        tree;
+  RBCacheSlot*   slots;
+  int            bits;
+  long           hits;
+  long           misses;
+  long           probes;
+};
+typedef struct rbcache RBCache;
+
+RBCache*  RBCache_init(RBTree* tree, int slots);
+uint32_t  RBCache_slot(RBCache* c, int key);
+RBNode*   RBCache_descend(RBCache* c, int key);
+RBNode*   RBCache_search(RBCache* c, int key);
+void      RBCache_set(RBCache* c, int key, RBNode* node);
+RBNode*   RBCache_insert(RBCache* c, int key);
+bool      RBCache_delete(RBCache* c, int key);
+double    RBCache_hitrate(RBCache* c);
+void      RBCache_free(RBCache* c);
+
+/*********************************************************/
+/* RED-BLACK MULTISET ************************************/
+/*********************************************************/
+
+/* An RBTree whose nodes are RBMSNodes: count copies of
+node.key, weight copies in the whole subtree */
+struct rbmsnode {
+  RBNode         node;
+  int            count;
+  int            weight;
+};
+typedef struct rbmsnode RBMSNode;
+
+RBTree*   RBMS_init(void);
+int       RBMS_weight(RBTree* tree, RBNode* x);
+void      RBMS_augment(RBTree* tree, RBNode* x);
+int       RBMS_insert(RBTree* tree, int key);
+bool      RBMS_remove(RBTree* tree, int key);
+int       RBMS_count(RBTree* tree, int key);
+int       RBMS_size(RBTree* tree);
+int       RBMS_rank(RBTree* tree, int key);
+int       RBMS_select(RBTree* tree, int i);
+
+/*********************************************************/
+/* RED-BLACK INTERVAL TREE *******************************/
+/*********************************************************/
+
+/* An RBTree keyed by lo whose nodes are RBIVNodes: the
+intervals [lo, hi] starting at node.key, their hi ends in
+his largest first, and max the largest hi in the subtree */
+struct rbivnode {
+  RBNode         node;
+  int*           his;
+  int            count;
+  int            cap;
+  int            max;
+};
+typedef struct rbivnode RBIVNode;
+
+struct interval {
+  int            lo;
+  int            hi;
+};
+typedef struct interval Interval;
+
+RBTree*   RBIV_init(void);
+int       RBIV_max(RBTree* tree, RBNode* x);
+void      RBIV_augment(RBTree* tree, RBNode* x);
+void      RBIV_insert(RBTree* tree, int lo, int hi);
+bool      RBIV_remove(RBTree* tree, int lo, int hi);
+int       RBIV_stab(RBTree* tree, int t, Interval* out,
+            int max);
+int       RBIV_overlap(RBTree* tree, int a, int b,
+            Interval* out, int max);
+void      RBIV_collect(RBTree* tree, RBNode* x, int a, int b,
+            Interval* out, int max, int* count);
+void      RBIV_free(RBTree* tree);
+void      RBIV_freehis(RBTree* tree, RBNode* x);
+
+/*********************************************************/
+/* RED-BLACK RANGE AGGREGATES ****************************/
+/*********************************************************/
+
+/* Count, sum, min and max of the values over some keys,
+min LONG_MAX and max LONG_MIN when there are none */
+struct rbaggsum {
+  long           count;
+  long           sum;
+  long           min;
+  long           max;
+};
+typedef struct rbaggsum RBAggSum;
+
+/* An RBTree whose nodes are RBAggNodes: the value stored
+under node.key and sub, the summary of its subtree */
+struct rbaggnode {
+  RBNode         node;
+  long           value;
+  RBAggSum       sub;
+};
+typedef struct rbaggnode RBAggNode;
+
+RBTree*   RBAgg_init(void);
+void      RBAgg_empty(RBAggSum* s);
+void      RBAgg_addvalue(RBAggSum* s, long value);
+void      RBAgg_addsum(RBAggSum* s, RBTree* tree, RBNode* x);
+void      RBAgg_augment(RBTree* tree, RBNode* x);
+void      RBAgg_put(RBTree* tree, int key, long value);
+bool      RBAgg_remove(RBTree* tree, int key);
+void      RBAgg_query(RBTree* tree, int lo, int hi,
+            RBAggSum* out);
+void      RBAgg_scan(RBTree* tree, int lo, int hi,
+            RBAggSum* out);
+
+/*********************************************************/
+/* PERSISTENT RED-BLACK BST ******************************/
+/*********************************************************/
+
+/* Nodes are shared between versions, refs counts the
+parents and snapshots holding each one */
+struct rbpnode {
+  rdblk            colour;
+  int              key;
+  int              refs;
+  struct rbpnode*  left;
+  struct rbpnode*  right;
+};
+typedef struct rbpnode RBPNode;
+
+struct rbptree {
+  RBPNode*       root;
+  int            size;
+  long           allocs;
+};
+typedef struct rbptree RBPTree;
+
+RBPTree*  RBP_init(void);
+RBPNode*  RBP_newnode(RBPTree* tree, rdblk colour, int key,
+            RBPNode* left, RBPNode* right);
+RBPNode*  RBP_retain(RBPNode* node);
+void      RBP_release(RBPNode* node);
+bool      RBP_isred(RBPNode* node);
+RBPNode*  RBP_balance(RBPNode* x);
+RBPNode*  RBP_ins(RBPTree* tree, RBPNode* x, int key);
+bool      RBP_insert(RBPTree* tree, int key);
+RBPNode*  RBP_snapshot(RBPTree* tree);
+bool      RBP_search(RBPNode* root, int key);
+int       RBP_height(RBPNode* node);
+void      RBP_free(RBPTree* tree);
+
+/*********************************************************/
+/* RED-BLACK HASH INDEX **********************************/
+/*********************************************************/
+
+/* Swiss-table layout, see rbhash.c. Control bytes are
+EMPTY, DELETED or h2, the top 7 bits of the hash */
+#define RBHASH_GROUP 16
+#define RBHASH_EMPTY 0x80
+#define RBHASH_DELETED 0xFE
+#define RBHASH_PHI 0x9E3779B97F4A7C15UL
+#define RBHASH_H2SHIFT 57
+#define RBHASH_H1SHIFT 25
+/* grow past 7/8 full, counting DELETED */
+#define RBHASH_LOADNUM 7
+#define RBHASH_LOADDEN 8
+/* SWAR fallback, 8 control bytes per 64-bit word */
+#define RBHASH_WORD 8
+#define RBHASH_BITS 64
+#define RBHASH_LSB 0x0101010101010101UL
+#define RBHASH_MSB 0x8080808080808080UL
+#define RBHASH_GATHER 0x0102040810204080UL
+
+struct rbhashslot {
+  int            key;
+  RBNode*        node;
+};
+typedef struct rbhashslot RBHashSlot;
+
+/* used counts full and DELETED slots, size full only */
+struct rbhash {
+  RBTree*        tree;
+  unsigned char* ctrl;
+  RBHashSlot*    slots;
+  uint32_t       gmask;
+  int            size;
+  int            used;
+};
+typedef struct rbhash RBHash;
+
+RBHash*   RBHash_init(RBTree* tree, int cap);
+uint64_t  RBHash_hash(int key);
+uint32_t  RBHash_match(unsigned char* ctrl,
+            unsigned char byte);
+long      RBHash_slot(RBHash* h, int key);
+RBNode*   RBHash_search(RBHash* h, int key);
+bool      RBHash_isin(RBHash* h, int key);
+void      RBHash_add(RBHash* h, int key, RBNode* node);
+void      RBHash_grow(RBHash* h, int n);
+RBNode*   RBHash_insert(RBHash* h, int key);
+bool      RBHash_delete(RBHash* h, int key);
+long      RBHash_bytes(RBHash* h);
+void      RBHash_free(RBHash* h);
+
+/*********************************************************/
+/* NODE ARENA ********************************************/
+/*********************************************************/
+
+/* 2MB, the x86-64 transparent huge page */
+#define ARENA_HUGEPAGE 2097152
+#define ARENA_BLOCK (32 * ARENA_HUGEPAGE)
+#define ARENA_ALIGN 16
+/* first byte after the block header, ARENA_ALIGN aligned */
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - \
+  ONE) / ARENA_ALIGN * ARENA_ALIGN)
+/* Arena_init flags */
+#define ARENA_HUGE 1
+#define ARENA_INTERLEAVE 2
+#define ARENA_BIND 4
+/* mbind node mask, room for 1024 nodes */
+#define ARENA_MASKWORDS 16
+#define ARENA_WORDBITS (8 * (int) sizeof(unsigned long))
+/* perf_event_attr.config fields for a cache event */
+#define ARENA_PERFOP 8
+#define ARENA_PERFRESULT 16
+
+/* Header at the start of each block, nodes follow it */
+struct arenablock {
+  struct arenablock* next;
+  size_t         size;
+  size_t         used;
+  bool           mapped;
+};
+typedef struct arenablock ArenaBlock;
+
+/* Blocks in the order they were made, cur is being filled.
+huge and numa: whether madvise and mbind took */
+struct arena {
+  ArenaBlock*    first;
+  ArenaBlock*    cur;
+  size_t         block;
+  int            flags;
+  int            node;
+  bool           huge;
+  bool           numa;
+  long           blocks;
+};
+typedef struct arena Arena;
+
+Arena*    Arena_init(size_t block, int flags, int node);
+void*     Arena_map(Arena* a, size_t size);
+void*     Arena_alloc(Arena* a, size_t size);
+ArenaBlock* Arena_newblock(Arena* a);
+void      Arena_pop(Arena* a, size_t size);
+RBNode*   Arena_rbinsert(Arena* a, RBTree* tree, int key);
+void      Arena_reset(Arena* a);
+void      Arena_free(Arena* a);
+/* ext.c's experiment with its nodes from an arena */
+Node*     node_insertarena(Node* node, int data, Arena* a);
+int       std_heightavgarena(int a[N], Arena* arena);
+int       RBTree_heightavgarena(int a[N], RBTree* tree,
+            Arena* arena);
+int       DTLB_open(void);
+void      DTLB_start(int fd);
+long      DTLB_stop(int fd);
+void      DTLB_close(int fd);
+
+/*********************************************************/
+/* STRING-KEY RED-BLACK BST ******************************/
+/*********************************************************/
+
+/* bytes of a key held in the node as one integer */
+#define STR_PREFIX ((int) sizeof(unsigned long))
+/* key text is taken from the arena STR_CHUNK at a time */
+#define STR_BLOCK ARENA_HUGEPAGE
+#define STR_CHUNK 65536
+
+/* prefix is the first STR_PREFIX bytes of str big-endian,
+so it orders as the text does */
+struct strkey {
+  unsigned long  prefix;
+  int            len;
+  const char*    str;
+};
+typedef struct strkey StrKey;
+
+/* See rbstr.c */
+DECLARE_RBTREE(RBStr, StrKey);
+DECLARE_RBTREE(RBStrPtr, const char*);
+
+struct strtree {
+  RBStr*         tree;
+  Arena*         keys;
+  char*          text;
+  size_t         left;
+  long           bytes;
+};
+typedef struct strtree StrTree;
+
+StrKey    StrKey_make(const char* s);
+int       StrKey_compare(StrKey a, StrKey b);
+StrTree*  StrTree_init(void);
+char*     StrTree_copy(StrTree* t, const char* s, int len);
+bool      StrTree_insert(StrTree* t, const char* s);
+bool      StrTree_search(StrTree* t, const char* s);
+void      StrTree_free(StrTree* t);
+bool      RBStrPtr_add(RBStrPtr* tree, const char* s);
+void      RBStrPtr_freekeys(RBStrPtr* tree);
+
+/*********************************************************/
+/* SHARDED RED-BLACK BST *********************************/
+/*********************************************************/
+
+/* shards in the benchmark and the threads it goes up to */
+#define SHARD_K 64
+#define SHARD_THREADS 16
+/* bytes kept between shards so no two locks share a line */
+#define SHARD_LINE 64
+
+/* keys RBShard_init's sample sets the bounds from in the
+benchmark */
+#define SHARD_SAMPLE 4096
+
+struct rbshard {
+  pthread_mutex_t lock;
+  RBTree*        tree;
+  long           size;
+  char           pad[SHARD_LINE];
+};
+typedef struct rbshard RBShard;
+
+/* Shard i holds the keys from bounds[i] up to but not
+including bounds[i + 1] (bounds[0] is INT_MIN, the last
+shard goes to INT_MAX) */
+struct rbshards {
+  RBShard*       shards;
+  int*           bounds;
+  int            k;
+};
+typedef struct rbshards RBShards;
+
+/* One thread's slice for RBShard_insertall */
+struct rbshardjob {
+  RBShards*      s;
+  int*           keys;
+  int            n;
+};
+typedef struct rbshardjob RBShardJob;
+
+RBShards* RBShard_init(int k, int* sample, int n);
+void      RBShard_setbounds(RBShards* s, int* sorted, int n);
+int       RBShard_compare(const void* a, const void* b);
+int       RBShard_lock(RBShards* s, int key);
+bool      RBShard_insert(RBShards* s, int key);
+bool      RBShard_search(RBShards* s, int key);
+bool      RBShard_delete(RBShards* s, int key);
+int       RBShard_range(RBShards* s, int lo, int hi,
+            int* out, int max);
+long      RBShard_size(RBShards* s);
+long      RBShard_largest(RBShards* s);
+void      RBShard_rebalance(RBShards* s);
+void*     RBShard_worker(void* arg);
+void      RBShard_insertall(RBShards* s, int* keys, int n,
+            int threads);
+void      RBShard_free(RBShards* s);
+
+/*********************************************************/
+/* PARALLEL WALKS ****************************************/
+/*********************************************************/
+
+/* subtrees handed out per thread, so one that is slow to
+finish leaves the others something to take */
+#define PAR_GRAIN 8
+/* threads in the benchmark */
+#define PAR_THREADS 8
+/* what a walk's jobs compute */
+#define PAR_SIZE 0
+#define PAR_HEIGHT 1
+#define PAR_ORDER 2
+
+/* One piece of a walk, in order: a whole subtree hanging
+at the cut (whole) or a node above it on its own, depth
+from the root (0), with what its job found */
+struct paritem {
+  void*          node;
+  int            depth;
+  bool           whole;
+  long           size;
+  int            height;
+  long           offset;
+};
+typedef struct paritem ParItem;
+
+/* tree is the RBTree for RBNodes, NULL for Nodes; out and
+the items' offsets are for PAR_ORDER */
+struct parwalk {
+  ParItem*       items;
+  int            count;
+  int            op;
+  RBTree*        tree;
+  int*           out;
+};
+typedef struct parwalk ParWalk;
+
+/* Jobs 0..jobs-1 shared out to the threads, each taking the
+next one free */
+struct parpool {
+  int            jobs;
+  int            next;
+  void           (*run)(void* ctx, int job);
+  void*          ctx;
+};
+typedef struct parpool ParPool;
+
+void      Par_run(int jobs, int threads,
+            void (*run)(void* ctx, int job), void* ctx);
+void*     Par_worker(void* arg);
+int       Par_cut(int threads);
+void      Par_add(ParWalk* w, void* node, int depth,
+            bool whole);
+void      Par_offsets(ParWalk* w);
+long      Par_size(ParWalk* w);
+int       Par_height(ParWalk* w);
+void      RBPar_frontier(ParWalk* w, RBNode* x, int depth,
+            int cut);
+void      RBPar_job(void* ctx, int job);
+void      RBPar_walk(ParWalk* w, RBTree* tree, int op,
+            int threads);
+long      RBNode_size(RBTree* tree, RBNode* x);
+void      RBNode_getordered(RBTree* tree, RBNode* x,
+            int** out);
+long      RBTree_sizepar(RBTree* tree, int threads);
+int       RBTree_heightpar(RBTree* tree, int threads);
+void      RBTree_getorderedpar(RBTree* tree, int* out,
+            int threads);
+long      node_size(Node* node);
+void      NodePar_frontier(ParWalk* w, Node* x, int depth,
+            int cut);
+void      NodePar_job(void* ctx, int job);
+long      node_sizepar(Node* root, int threads);
+int       node_heightpar(Node* root, int threads);
+
+/*********************************************************/
+/* WRITE-AHEAD LOG ***************************************/
+/*********************************************************/
+
+/* a record is the op byte then the key, little-endian */
+#define WAL_INSERT 1
+#define WAL_DELETE 2
+#define WAL_RECORD 5
+#define WAL_BUF 65536
+#define WAL_MODE 0644
+/* suffixes of the snapshot and of the one being written */
+#define WAL_SNAP ".snap"
+#define WAL_TMP ".tmp"
+/* compact once the log has this many records per key held,
+counting WAL_MINLOG more keys so small trees are not
+compacted all the time */
+#define WAL_COMPACT 2
+#define WAL_MINLOG 65536
+
+/* records counts the log file's, buffered or not; pending
+those since the last commit */
+struct rbwal {
+  RBTree*        tree;
+  long           size;
+  int            fd;
+  char*          path;
+  char*          snap;
+  unsigned char* buf;
+  int            used;
+  int            batch;
+  int            pending;
+  long           records;
+  long           syncs;
+};
+typedef struct rbwal RBWal;
+
+RBWal*    RBWal_open(const char* path, int batch);
+void      RBWal_load(RBWal* w);
+void      RBWal_replay(RBWal* w);
+bool      RBWal_apply(RBWal* w, bool insert, int key);
+bool      RBWal_insert(RBWal* w, int key);
+bool      RBWal_delete(RBWal* w, int key);
+bool      RBWal_search(RBWal* w, int key);
+void      RBWal_append(RBWal* w, unsigned char op, int key);
+void      RBWal_write(RBWal* w);
+void      RBWal_commit(RBWal* w);
+void      RBWal_compact(RBWal* w);
+void      RBWal_close(RBWal* w);
+void      RBWal_remove(const char* path);
+void      RBWal_putkey(unsigned char* p, int key);
+int       RBWal_getkey(unsigned char* p);
+
+/*********************************************************/
+/* ENGINE TABLE ******************************************/
+/*********************************************************/
+
+/* Common face of the int-key trees, see engine.c */
+struct engine {
+  char*          name;
+  void*          (*init)(void);
+  void           (*insert)(void* tree, int key);
+  bool           (*search)(void* tree, int key);
+  int            (*height)(void* tree);
+  void           (*free)(void* tree);
+};
+typedef struct engine Engine;
+
+Engine*   engine_table(int* n);
+int       engine_heightworst(Engine* e);
+int       engine_heightavg(Engine* e, int a[N]);
+
+/*********************************************************/
+/* BENCHMARKS ********************************************/
+/*********************************************************/
+
+/* ./ext bench [name|all] [n] */
+#define BENCH_N 1000000
+#define KB 1024
+#define ZIPF_S 0.99
+#define LOCAL_W 1024
+#define CHURN 64
+/* bench_finger's random walk moves at most this far */
+#define FINGER_WALK 8
+/* bench_rbiv's interval lengths and its queries of each
+kind, each of which the scan answers in O(n) */
+#define RBIV_LEN 64
+#define RBIV_QUERIES 1000
+/* bench_rbagg's queries per range width */
+#define RBAGG_QUERIES 1000
+/* bench_strkey's URL hosts and the longest word it makes */
+#define STRK_HOSTS 16
+#define STRK_WORD 12
+/* bench_wal's log and the most commits a batch size gets */
+#define WAL_BENCH "/tmp/rbwal.bench"
+#define WAL_SYNCS 1000
+
+struct benchcase {
+  char*          name;
+  void           (*run)(int n);
+};
+typedef struct benchcase BenchCase;
+
+int       bench_run(int argc, char* argv[]);
+double    bench_secs(clock_t start);
+double    bench_nsop(clock_t start, int ops);
+long      bench_rsskb(void);
+void      bench_shuffle(int* a, int n);
+int*      bench_keys(int n);
+void      bench_header(char* title, char* c1, char* c2,
+            char* c3);
+int*      bench_zipf(int n, int m, double s);
+int*      bench_local(int n, int m, int w);
+void      bench_heappush(int* h, int* size, int key);
+int       bench_heappop(int* h, int* size);
+void      bench_rbidx(int n);
+void      bench_rbtd(int n);
+void      bench_engines(int n);
+void      bench_rbcache(int n);
+void      bench_batch(int n);
+void      bench_rbtmpl(int n);
+void      bench_rbmap(int n);
+void      bench_rbms(int n);
+void      bench_rbpers(int n);
+void      bench_rbhash(int n);
+void      bench_arena(int n);
+void      bench_finger(int n);
+double    bench_wall(void);
+void      bench_shard(int n);
+void      bench_rbiv(int n);
+void      bench_rbagg(int n);
+void      bench_pq(int n);
+void      bench_par(int n);
+char**    bench_words(int n, bool urls);
+void      bench_strkey(int n);
+void      bench_art(int n);
+void      bench_wal(int n);
+
+/*********************************************************/
+/* HEIGHT DISTRIBUTION ***********************************/
+/*********************************************************/
+
+/* ./ext height [n] [trials]; levels stop when P(H <= h)
+is this close to 1 */
+#define HDIST_EPS 1e-12
+#define HDIST_MAXH 256
+/* heights printed, and the |z| the simulated mean must
+stay under */
+#define HDIST_SHOW 1e-6
+#define HDIST_Z 4
+/* sizes in the band HDist_init multiplies out, above which
+it goes by FFT */
+#define HDIST_FFT 256
+
+/* cdf[h] is P(H <= h) for h = 0..maxh */
+struct hdist {
+  int            n;
+  int            maxh;
+  double*        cdf;
+};
+typedef struct hdist HDist;
+
+/* HDist_square's workspace: cap points, and the twiddles
+for the size last used */
+struct hdistfft {
+  double*        re;
+  double*        im;
+  double*        wre;
+  double*        wim;
+  int            cap;
+  int            size;
+};
+typedef struct hdistfft HDistFFT;
+
+HDist*    HDist_init(int n);
+double    HDist_conv(double* p, int lo, int hi);
+void      HDistFFT_init(HDistFFT* f, int len);
+void      HDistFFT_free(HDistFFT* f);
+void      HDist_square(HDistFFT* f, double* p, int len);
+void      HDist_fft(HDistFFT* f, bool inverse);
+double    HDist_pmf(HDist* d, int h);
+double    HDist_tail(HDist* d, int h);
+double    HDist_mean(HDist* d);
+double    HDist_var(HDist* d);
+void      HDist_free(HDist* d);
+int       hdist_run(int argc, char* argv[]);
+
+/*********************************************************/
+/* STRESS ************************************************/
+/*********************************************************/
+
+/* ./ext stress [ops] [seed] */
+#define STRESS_OPS 1000000
+#define STRESS_KEYS 4096
+#define STRESS_CHECK 100000
+
+int       stress_run(int argc, char* argv[]);
+int       stress_find(int* a, int n, int key);
+bool      stress_check(RBTree* tree, RBHash* h,
+            RBTDTree* td, WAVLTree* wavl, int* oracle,
+            int n);
 
 /*********************************************************/
 /* MISC **************************************************/
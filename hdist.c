@@ -0,0 +1,411 @@
+/*********************************************************/
+/* HDIST.C ***********************************************/
+/*********************************************************/
+
+/* Exact distribution of the height of a random BST, the
+tree node_insert builds from the keys in a random order,
+where main estimates its mean from SAMPLESIZE trees. The
+root is equally likely to be any of the n keys, and then
+the two subtrees are themselves random BSTs of sizes k - 1
+and n - k, so with P_n(h) the chance a tree of n keys has
+height at most h (counted in nodes, as node_height does)
+
+  P_0(h) = 1, P_n(0) = 0 for n > 0 and
+  P_n(h) = 1/n sum over k = 1..n of
+           P_{k-1}(h - 1) P_{n-k}(h - 1).
+
+Each level h needs only level h - 1, for every size up to
+n, so the table is filled a level at a time keeping two
+rows; a row is a convolution of the one before with
+itself, O(n^2) for the level done term by term. But
+P_k(h - 1) falls from 1 to 0 as k grows, and outside a
+band of sizes [a, z) it is within HDIST_EPS of one or the
+other. Taking those as exactly 1 and 0, a pair with both
+below a counts 1, one below a and one in the band counts
+the other (a running sum over the band), and one at z or
+above nothing. Only pairs both in the band are multiplied
+out: term by term for a narrow band, and for a wide one
+(at n = 10000 it is most sizes from h = 24 on) by squaring
+the band's FFT, O(n log n) for all sizes at once. Levels
+stop once P_n(h) is within HDIST_EPS of 1, and the
+variance of the height stays O(1) as n grows, so only a
+few dozen are needed.
+
+./ext height [n] [trials] prints the distribution with the
+mean, variance and tails, beside those of trials random
+trees built as main does, and a z-score for the means. */
+
+#include "ext.h"
+
+HDist* HDist_init(int n)
+{
+  HDist *d;
+  double *prev, *cur, *swap, *sum, c;
+  HDistFFT f;
+  int h, m, s, a, z, lo, hi;
+
+  if(n < ZERO){
+    ON_ERROR("Size to HDist_init is < 0\n");
+  }
+  d = (HDist*) gfmalloc(sizeof(HDist));
+  d->n = n;
+  d->cdf = (double*) gfmalloc(HDIST_MAXH * sizeof(double));
+  prev = (double*) gfmalloc(((size_t) n + ONE) *
+    sizeof(double));
+  cur = (double*) gfmalloc(((size_t) n + ONE) *
+    sizeof(double));
+  sum = (double*) gfmalloc(((size_t) n + TWO) *
+    sizeof(double));
+  HDistFFT_init(&f, TWO * n + ONE);
+
+  /* level 0: only the empty tree */
+  prev[ZERO] = ONE;
+  for(m = ONE; m <= n; m++){
+    prev[m] = ZERO;
+  }
+  d->cdf[ZERO] = prev[n];
+  for(h = ONE; d->cdf[h - ONE] < ONE - HDIST_EPS; h++){
+    if(h == HDIST_MAXH){
+      ON_ERROR("HDist_init needs over HDIST_MAXH levels\n");
+    }
+    /* prev falls with the size: taken as 1 below a and 0
+    from z on, only [a, z) is read */
+    a = ZERO;
+    while(a <= n && prev[a] >= ONE - HDIST_EPS){
+      a++;
+    }
+    z = a;
+    while(z <= n && prev[z] >= HDIST_EPS){
+      z++;
+    }
+    sum[a] = ZERO;
+    for(m = a; m < z; m++){
+      sum[m + ONE] = sum[m] + prev[m];
+    }
+    if(z - a > HDIST_FFT){
+      HDist_square(&f, prev + a, z - a);
+    }
+
+    cur[ZERO] = ONE;
+    for(m = ONE; m <= n; m++){
+      /* the pairs i + j = s, split by where i and j are */
+      s = m - ONE;
+      if(s > TWO * (z - ONE)){
+        cur[m] = ZERO;
+        continue;
+      }
+      /* both below a */
+      lo = s - a + ONE > ZERO ? s - a + ONE : ZERO;
+      hi = s < a - ONE ? s : a - ONE;
+      c = hi >= lo ? hi - lo + ONE : ZERO;
+      /* one below a, the other j in [a, z), either way */
+      lo = a > s - a + ONE ? a : s - a + ONE;
+      hi = s < z - ONE ? s : z - ONE;
+      if(hi >= lo){
+        c += TWO * (sum[hi + ONE] - sum[lo]);
+      }
+      /* both in [a, z) */
+      if(z - a > HDIST_FFT){
+        if(s - TWO * a >= ZERO){
+          c += f.re[s - TWO * a];
+        }
+      }
+      else {
+        lo = a > s - z + ONE ? a : s - z + ONE;
+        if(lo <= s - lo){
+          c += HDist_conv(prev, lo, s - lo);
+        }
+      }
+      cur[m] = c / m;
+    }
+    d->cdf[h] = cur[n];
+    swap = prev;
+    prev = cur;
+    cur = swap;
+  }
+  d->maxh = h - ONE;
+  free(prev);
+  free(cur);
+  free(sum);
+  HDistFFT_free(&f);
+
+  return d;
+}
+
+/* sum of p[i] p[j] over i + j = lo + hi, lo <= i, j <= hi.
+Kept in four running sums so the loop is not one chain of
+dependent adds, which the compiler may not reorder itself
+without -ffast-math */
+double HDist_conv(double* p, int lo, int hi)
+{
+  double s0 = ZERO, s1 = ZERO, s2 = ZERO, s3 = ZERO, sum;
+  int i = lo, j = hi;
+
+  while(j - i >= SEVEN){
+    s0 += p[i] * p[j];
+    s1 += p[i + ONE] * p[j - ONE];
+    s2 += p[i + TWO] * p[j - TWO];
+    s3 += p[i + THREE] * p[j - THREE];
+    i += FOUR;
+    j -= FOUR;
+  }
+  while(i < j){
+    s0 += p[i] * p[j];
+    i++;
+    j--;
+  }
+  sum = TWO * (s0 + s1 + s2 + s3);
+  if(i == j){
+    sum += p[i] * p[i];
+  }
+  return sum;
+}
+
+/* Room for transforms of up to len points */
+void HDistFFT_init(HDistFFT* f, int len)
+{
+  f->cap = ONE;
+  while(f->cap < len){
+    f->cap *= TWO;
+  }
+  f->re = (double*) gfmalloc((size_t) f->cap *
+    sizeof(double));
+  f->im = (double*) gfmalloc((size_t) f->cap *
+    sizeof(double));
+  f->wre = (double*) gfmalloc((size_t) f->cap / TWO *
+    sizeof(double) + sizeof(double));
+  f->wim = (double*) gfmalloc((size_t) f->cap / TWO *
+    sizeof(double) + sizeof(double));
+  f->size = ZERO;
+}
+
+void HDistFFT_free(HDistFFT* f)
+{
+  free(f->re);
+  free(f->im);
+  free(f->wre);
+  free(f->wim);
+}
+
+/* f->re[k] = sum of p[i] p[k - i], for k = 0..2 len - 2:
+transform, square each point and transform back, with
+rounding errors around 1e-16 times the biggest sum */
+void HDist_square(HDistFFT* f, double* p, int len)
+{
+  double angle, re;
+  int size = ONE, k;
+
+  while(size < TWO * len - ONE){
+    size *= TWO;
+  }
+  /* the twiddles are only worked out again for a new size */
+  if(size != f->size){
+    f->size = size;
+    angle = TWO * acos(-ONE) / size;
+    for(k = ZERO; k < size / TWO; k++){
+      f->wre[k] = cos(angle * k);
+      f->wim[k] = -sin(angle * k);
+    }
+  }
+  for(k = ZERO; k < size; k++){
+    f->re[k] = k < len ? p[k] : ZERO;
+    f->im[k] = ZERO;
+  }
+  HDist_fft(f, false);
+  for(k = ZERO; k < size; k++){
+    re = f->re[k];
+    f->re[k] = re * re - f->im[k] * f->im[k];
+    f->im[k] = TWO * re * f->im[k];
+  }
+  HDist_fft(f, true);
+  for(k = ZERO; k < size; k++){
+    f->re[k] /= size;
+  }
+}
+
+/* In place radix-2 transform of f->re + i f->im over
+f->size points, inverse without the 1 / size */
+void HDist_fft(HDistFFT* f, bool inverse)
+{
+  double *re = f->re, *im = f->im, wr, wi, tr, ti;
+  int size = f->size, i, j, k, bit, len, half, step;
+
+  /* bit-reversed order first */
+  for(i = ONE, j = ZERO; i < size; i++){
+    for(bit = size / TWO; j & bit; bit /= TWO){
+      j ^= bit;
+    }
+    j ^= bit;
+    if(i < j){
+      tr = re[i];
+      re[i] = re[j];
+      re[j] = tr;
+      ti = im[i];
+      im[i] = im[j];
+      im[j] = ti;
+    }
+  }
+  for(len = TWO; len <= size; len *= TWO){
+    half = len / TWO;
+    step = size / len;
+    for(i = ZERO; i < size; i += len){
+      for(k = ZERO; k < half; k++){
+        wr = f->wre[k * step];
+        wi = inverse ? -f->wim[k * step] : f->wim[k * step];
+        j = i + k + half;
+        tr = re[j] * wr - im[j] * wi;
+        ti = re[j] * wi + im[j] * wr;
+        re[j] = re[i + k] - tr;
+        im[j] = im[i + k] - ti;
+        re[i + k] += tr;
+        im[i + k] += ti;
+      }
+    }
+  }
+}
+
+/* P(H = h) */
+double HDist_pmf(HDist* d, int h)
+{
+  if(h < ZERO || h > d->maxh){
+    return ZERO;
+  }
+  if(h == ZERO){
+    return d->cdf[ZERO];
+  }
+  return d->cdf[h] - d->cdf[h - ONE];
+}
+
+/* P(H >= h) */
+double HDist_tail(HDist* d, int h)
+{
+  if(h <= ZERO){
+    return ONE;
+  }
+  if(h > d->maxh){
+    return ZERO;
+  }
+  return ONE - d->cdf[h - ONE];
+}
+
+/* E[H] is the sum of P(H > h) over h >= 0 */
+double HDist_mean(HDist* d)
+{
+  double mean = ZERO;
+  int h;
+
+  for(h = ZERO; h < d->maxh; h++){
+    mean += ONE - d->cdf[h];
+  }
+  return mean;
+}
+
+/* E[H^2] is the sum of (2h + 1) P(H > h) */
+double HDist_var(HDist* d)
+{
+  double sq = ZERO, mean;
+  int h;
+
+  mean = HDist_mean(d);
+  for(h = ZERO; h < d->maxh; h++){
+    sq += (TWO * h + ONE) * (ONE - d->cdf[h]);
+  }
+  return sq - mean * mean;
+}
+
+void HDist_free(HDist* d)
+{
+  free(d->cdf);
+  free(d);
+}
+
+/* ./ext height [n] [trials] */
+int hdist_run(int argc, char* argv[])
+{
+  HDist *d;
+  Node *root;
+  int n = N, trials = SAMPLESIZE, i, j, h, height, *keys;
+  long *count;
+  double mean, var, smean = ZERO, svar = ZERO, z;
+  double dp_ms, sim_ms;
+  clock_t t;
+
+  if(argc > ZERO){
+    n = atoi(argv[ZERO]);
+  }
+  if(argc > ONE){
+    trials = atoi(argv[ONE]);
+  }
+  if(n <= ZERO || trials <= ONE){
+    ON_ERROR("hdist_run needs n > 0 and trials > 1\n");
+  }
+  srand(time(NULL));
+
+  t = clock();
+  d = HDist_init(n);
+  dp_ms = bench_secs(t) * 1e3;
+  mean = HDist_mean(d);
+  var = HDist_var(d);
+
+  /* trees as std_heightavg builds them */
+  count = (long*) gfmalloc(((size_t) n + ONE) * sizeof(long));
+  for(h = ZERO; h <= n; h++){
+    count[h] = ZERO;
+  }
+  keys = (int*) gfmalloc((size_t) n * sizeof(int));
+  for(i = ZERO; i < n; i++){
+    keys[i] = i;
+  }
+  t = clock();
+  for(j = ZERO; j < trials; j++){
+    bench_shuffle(keys, n);
+    root = NULL;
+    for(i = ZERO; i < n; i++){
+      root = node_insert(root, keys[i]);
+    }
+    height = node_height(root);
+    std_free(root);
+    count[height]++;
+    smean += height;
+    svar += (double) height * height;
+  }
+  sim_ms = bench_secs(t) * 1e3;
+  smean /= trials;
+  svar = (svar - trials * smean * smean) / (trials - ONE);
+  /* the sample mean's error in standard errors; for n = 1
+  or 2 every tree has the same height, so the means must
+  simply match */
+  if(var > HDIST_EPS){
+    z = (smean - mean) / sqrt(var / trials);
+  }
+  else {
+    z = fabs(smean - mean) < HDIST_EPS ? ZERO : HUGE_VAL;
+  }
+
+  printf("\n  [height] n = %d, %d random BSTs\n", n, trials);
+  bench_header("Height", "Exact P", "Simulated",
+    "Exact P(H>=h)");
+  for(h = ZERO; h <= n; h++){
+    if(HDist_pmf(d, h) >= HDIST_SHOW || count[h] > ZERO){
+      printf("  %-14d | %-14.6f | %-14.6f | %-14.3e\n", h,
+        HDist_pmf(d, h), (double) count[h] / trials,
+        HDist_tail(d, h));
+    }
+  }
+  bench_header("", "Exact", "Simulated", "");
+  printf("  %-14s | %-14.4f | %-14.4f | z = %.2f\n", "Mean",
+    mean, smean, z);
+  printf("  %-14s | %-14.4f | %-14.4f |\n", "Variance", var,
+    svar);
+  printf("  %-14s | %-14.1f | %-14.1f |\n", "ms", dp_ms,
+    sim_ms);
+  printf("\n  simulation %s the exact mean (|z| %s %d)\n\n",
+    fabs(z) < HDIST_Z ? "agrees with" : "DISAGREES with",
+    fabs(z) < HDIST_Z ? "<" : ">=", HDIST_Z);
+
+  HDist_free(d);
+  free(count);
+  free(keys);
+
+  return fabs(z) < HDIST_Z ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,323 @@
+/*********************************************************/
+/* PAR.C *************************************************/
+/*********************************************************/
+
+/* Fork-join versions of the whole-tree walks (size, height
+and the keys in order) for RBTree and the standard BST.
+The tree is cut at the depth that leaves PAR_GRAIN
+subtrees per thread; the nodes above the cut are taken one
+by one and the subtrees below it are the jobs, all listed
+in key order. Threads take the next job free from a shared
+counter, so a thread whose subtrees were small just takes
+more of them, and the results are combined by the caller:
+sizes add up, heights add the depth of the cut, and for
+the ordered export a first pass of sizes gives each job the
+place its keys start in the output, so the second pass
+writes all of them at once with no merging. */
+
+#include "ext.h"
+
+/* The caller's thread is one of threads */
+void Par_run(int jobs, int threads,
+  void (*run)(void* ctx, int job), void* ctx)
+{
+  ParPool pool;
+  pthread_t *tid;
+  int t;
+
+  if(threads <= ZERO){
+    ON_ERROR("Threads to Par_run is <= 0\n");
+  }
+  pool.jobs = jobs;
+  pool.next = ZERO;
+  pool.run = run;
+  pool.ctx = ctx;
+
+  tid = (pthread_t*) gfmalloc((size_t) threads *
+    sizeof(pthread_t));
+  for(t = ONE; t < threads; t++){
+    if(pthread_create(&tid[t], NULL, Par_worker, &pool) !=
+      ZERO){
+      ON_ERROR("Par_run could not start a thread\n");
+    }
+  }
+  Par_worker(&pool);
+  for(t = ONE; t < threads; t++){
+    pthread_join(tid[t], NULL);
+  }
+  free(tid);
+}
+
+void* Par_worker(void* arg)
+{
+  ParPool *pool = (ParPool*) arg;
+  int job;
+
+  while((job = __sync_fetch_and_add(&pool->next, ONE)) <
+    pool->jobs){
+    pool->run(pool->ctx, job);
+  }
+  return NULL;
+}
+
+/* Depth with at least PAR_GRAIN subtrees per thread below
+it in a full tree */
+int Par_cut(int threads)
+{
+  int cut = ZERO;
+
+  while((ONE << cut) < threads * PAR_GRAIN){
+    cut++;
+  }
+  return cut;
+}
+
+void Par_add(ParWalk* w, void* node, int depth, bool whole)
+{
+  ParItem *it = &w->items[w->count++];
+
+  it->node = node;
+  it->depth = depth;
+  it->whole = whole;
+  it->size = ZERO;
+  it->height = ZERO;
+  it->offset = ZERO;
+}
+
+/* Each item's first place in the output, from its size */
+void Par_offsets(ParWalk* w)
+{
+  long offset = ZERO;
+  int i;
+
+  for(i = ZERO; i < w->count; i++){
+    w->items[i].offset = offset;
+    offset += w->items[i].size;
+  }
+}
+
+long Par_size(ParWalk* w)
+{
+  long size = ZERO;
+  int i;
+
+  for(i = ZERO; i < w->count; i++){
+    size += w->items[i].size;
+  }
+  return size;
+}
+
+int Par_height(ParWalk* w)
+{
+  int height = ZERO, i;
+
+  for(i = ZERO; i < w->count; i++){
+    if(w->items[i].depth + w->items[i].height > height){
+      height = w->items[i].depth + w->items[i].height;
+    }
+  }
+  return height;
+}
+
+/*********************************************************/
+/* RED-BLACK BST *****************************************/
+/*********************************************************/
+
+/* Items of the subtree at x, in order */
+void RBPar_frontier(ParWalk* w, RBNode* x, int depth,
+  int cut)
+{
+  if(x == w->tree->nil){
+    return;
+  }
+  if(depth == cut){
+    Par_add(w, x, depth, true);
+    return;
+  }
+  RBPar_frontier(w, x->left, depth + ONE, cut);
+  Par_add(w, x, depth, false);
+  RBPar_frontier(w, x->right, depth + ONE, cut);
+}
+
+void RBPar_job(void* ctx, int job)
+{
+  ParWalk *w = (ParWalk*) ctx;
+  ParItem *it = &w->items[job];
+  RBNode *x = (RBNode*) it->node;
+  int *out;
+
+  if(!it->whole){
+    it->size = it->height = ONE;
+    if(w->op == PAR_ORDER){
+      w->out[it->offset] = x->key;
+    }
+    return;
+  }
+  if(w->op == PAR_SIZE){
+    it->size = RBNode_size(w->tree, x);
+  }
+  else if(w->op == PAR_HEIGHT){
+    it->height = RBNode_height(w->tree, x);
+  }
+  else {
+    out = w->out + it->offset;
+    RBNode_getordered(w->tree, x, &out);
+  }
+}
+
+/* List the items and run op on them, the caller frees
+w->items */
+void RBPar_walk(ParWalk* w, RBTree* tree, int op,
+  int threads)
+{
+  int cut;
+
+  cut = Par_cut(threads);
+  w->items = (ParItem*) gfmalloc(sizeof(ParItem) *
+    ((size_t) TWO << cut));
+  w->count = ZERO;
+  w->op = op;
+  w->tree = tree;
+  w->out = NULL;
+  RBPar_frontier(w, tree->root->left, ZERO, cut);
+  Par_run(w->count, threads, RBPar_job, w);
+}
+
+long RBNode_size(RBTree* tree, RBNode* x)
+{
+  if(x == tree->nil){
+    return ZERO;
+  }
+  return RBNode_size(tree, x->left) +
+    RBNode_size(tree, x->right) + ONE;
+}
+
+/* Keys of the subtree at x in order to *out, moving it on */
+void RBNode_getordered(RBTree* tree, RBNode* x, int** out)
+{
+  if(x != tree->nil){
+    RBNode_getordered(tree, x->left, out);
+    *(*out)++ = x->key;
+    RBNode_getordered(tree, x->right, out);
+  }
+}
+
+long RBTree_sizepar(RBTree* tree, int threads)
+{
+  ParWalk w;
+  long size;
+
+  RBPar_walk(&w, tree, PAR_SIZE, threads);
+  size = Par_size(&w);
+  free(w.items);
+
+  return size;
+}
+
+/* As RBNode_height(tree, tree->root->left) */
+int RBTree_heightpar(RBTree* tree, int threads)
+{
+  ParWalk w;
+  int height;
+
+  RBPar_walk(&w, tree, PAR_HEIGHT, threads);
+  height = Par_height(&w);
+  free(w.items);
+
+  return height;
+}
+
+/* Every key in order into out, which has room for them */
+void RBTree_getorderedpar(RBTree* tree, int* out,
+  int threads)
+{
+  ParWalk w;
+
+  RBPar_walk(&w, tree, PAR_SIZE, threads);
+  Par_offsets(&w);
+  w.op = PAR_ORDER;
+  w.out = out;
+  Par_run(w.count, threads, RBPar_job, &w);
+  free(w.items);
+}
+
+/*********************************************************/
+/* STANDARD BST ******************************************/
+/*********************************************************/
+
+void NodePar_frontier(ParWalk* w, Node* x, int depth,
+  int cut)
+{
+  if(x == NULL){
+    return;
+  }
+  if(depth == cut){
+    Par_add(w, x, depth, true);
+    return;
+  }
+  NodePar_frontier(w, x->left, depth + ONE, cut);
+  Par_add(w, x, depth, false);
+  NodePar_frontier(w, x->right, depth + ONE, cut);
+}
+
+void NodePar_job(void* ctx, int job)
+{
+  ParWalk *w = (ParWalk*) ctx;
+  ParItem *it = &w->items[job];
+
+  if(!it->whole){
+    it->size = it->height = ONE;
+  }
+  else if(w->op == PAR_SIZE){
+    it->size = node_size((Node*) it->node);
+  }
+  else {
+    it->height = node_height((Node*) it->node);
+  }
+}
+
+long node_size(Node* node)
+{
+  if(node == NULL){
+    return ZERO;
+  }
+  return node_size(node->left) + node_size(node->right) +
+    ONE;
+}
+
+long node_sizepar(Node* root, int threads)
+{
+  ParWalk w;
+  long size;
+  int cut;
+
+  cut = Par_cut(threads);
+  w.items = (ParItem*) gfmalloc(sizeof(ParItem) *
+    ((size_t) TWO << cut));
+  w.count = ZERO;
+  w.op = PAR_SIZE;
+  NodePar_frontier(&w, root, ZERO, cut);
+  Par_run(w.count, threads, NodePar_job, &w);
+  size = Par_size(&w);
+  free(w.items);
+
+  return size;
+}
+
+int node_heightpar(Node* root, int threads)
+{
+  ParWalk w;
+  int height, cut;
+
+  cut = Par_cut(threads);
+  w.items = (ParItem*) gfmalloc(sizeof(ParItem) *
+    ((size_t) TWO << cut));
+  w.count = ZERO;
+  w.op = PAR_HEIGHT;
+  NodePar_frontier(&w, root, ZERO, cut);
+  Par_run(w.count, threads, NodePar_job, &w);
+  height = Par_height(&w);
+  free(w.items);
+
+  return height;
+}
@@ -0,0 +1,156 @@
+/*********************************************************/
+/* RBAGG.C ***********************************************/
+/*********************************************************/
+
+/* Map from int keys to long values on top of RBTree where
+every node also holds the count, sum, min and max of the
+values in its subtree, kept right through the rotations by
+RBTree's augment hook. The summary of a key range [lo, hi)
+is then put together from the O(log n) nodes and whole
+subtrees along the two paths bounding the range, rather
+than by visiting each of its k keys as RBAgg_scan does. */
+
+#include "ext.h"
+
+RBTree* RBAgg_init(void)
+{
+  RBTree *tree;
+
+  tree = RBTree_init();
+  tree->augment = RBAgg_augment;
+
+  return tree;
+}
+
+void RBAgg_empty(RBAggSum* s)
+{
+  s->count = s->sum = ZERO;
+  s->min = LONG_MAX;
+  s->max = LONG_MIN;
+}
+
+void RBAgg_addvalue(RBAggSum* s, long value)
+{
+  s->count++;
+  s->sum += value;
+  if(value < s->min){
+    s->min = value;
+  }
+  if(value > s->max){
+    s->max = value;
+  }
+}
+
+/* Fold in the whole subtree at x */
+void RBAgg_addsum(RBAggSum* s, RBTree* tree, RBNode* x)
+{
+  RBAggSum *sub;
+
+  if(x == tree->nil){
+    return;
+  }
+  sub = &((RBAggNode*) x)->sub;
+  s->count += sub->count;
+  s->sum += sub->sum;
+  if(sub->min < s->min){
+    s->min = sub->min;
+  }
+  if(sub->max > s->max){
+    s->max = sub->max;
+  }
+}
+
+void RBAgg_augment(RBTree* tree, RBNode* x)
+{
+  RBAggNode *a = (RBAggNode*) x;
+
+  RBAgg_empty(&a->sub);
+  RBAgg_addvalue(&a->sub, a->value);
+  RBAgg_addsum(&a->sub, tree, x->left);
+  RBAgg_addsum(&a->sub, tree, x->right);
+}
+
+/* Set key's value, adding the key if it is new */
+void RBAgg_put(RBTree* tree, int key, long value)
+{
+  RBNode *x;
+  RBAggNode *a;
+
+  x = RBTree_search(tree, key);
+  if(x != tree->nil){
+    ((RBAggNode*) x)->value = value;
+    RBTree_augmentup(tree, x);
+    return;
+  }
+  a = (RBAggNode*) gfmalloc(sizeof(RBAggNode));
+  a->node.key = key;
+  a->value = value;
+  RBAgg_empty(&a->sub);
+  RBAgg_addvalue(&a->sub, value);
+  RBTree_insertnode(tree, &a->node);
+}
+
+bool RBAgg_remove(RBTree* tree, int key)
+{
+  return RBTree_delete(tree, key);
+}
+
+/* Summary of the values under keys lo <= key < hi */
+void RBAgg_query(RBTree* tree, int lo, int hi, RBAggSum* out)
+{
+  RBNode *x, *y, *nil = tree->nil;
+
+  RBAgg_empty(out);
+  /* down to the first node inside the range, both paths
+  part there */
+  x = tree->root->left;
+  while(x != nil && (x->key < lo || x->key >= hi)){
+    if(x->key < lo){
+      x = x->right;
+    }
+    else {
+      x = x->left;
+    }
+  }
+  if(x == nil){
+    return;
+  }
+  RBAgg_addvalue(out, ((RBAggNode*) x)->value);
+
+  /* left path: a node at or above lo is in, and so is all
+  of its right subtree */
+  for(y = x->left; y != nil; ){
+    if(y->key >= lo){
+      RBAgg_addvalue(out, ((RBAggNode*) y)->value);
+      RBAgg_addsum(out, tree, y->right);
+      y = y->left;
+    }
+    else {
+      y = y->right;
+    }
+  }
+  /* right path, the mirror image against hi */
+  for(y = x->right; y != nil; ){
+    if(y->key < hi){
+      RBAgg_addvalue(out, ((RBAggNode*) y)->value);
+      RBAgg_addsum(out, tree, y->left);
+      y = y->right;
+    }
+    else {
+      y = y->left;
+    }
+  }
+}
+
+/* The same summary by walking the k keys in range, O(k) */
+void RBAgg_scan(RBTree* tree, int lo, int hi, RBAggSum* out)
+{
+  RBNode *x;
+
+  RBAgg_empty(out);
+  x = RBTree_lowerbound(tree, lo);
+  while(x != tree->nil && x->key < hi){
+    RBAgg_addvalue(out, ((RBAggNode*) x)->value);
+    x = RBTree_next(tree, x);
+  }
+}
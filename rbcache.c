@@ -0,0 +1,140 @@
+/*********************************************************/
+/* RBCACHE.C *********************************************/
+/*********************************************************/
+
+/* Small direct-mapped cache of search results sitting in
+front of an RBTree. A key hashes to one slot which holds
+the key and the RBNode* found for it (tree->nil for a key
+that is not there), so a repeat lookup of a hot key costs
+one slot read instead of a walk down the tree. Inserts and
+deletes through the cache overwrite the key's slot, and as
+RBTree_delete moves nodes rather than copying keys between
+them no other cached pointer goes stale. */
+
+#include "ext.h"
+
+/* slots is rounded up to a power of two, 0 turns the
+cache off so that the same code measures the bare tree */
+RBCache* RBCache_init(RBTree* tree, int slots)
+{
+  RBCache *c;
+  int i;
+
+  c = (RBCache*) gfmalloc(sizeof(RBCache));
+  c->tree = tree;
+  c->slots = NULL;
+  c->bits = ZERO;
+  c->hits = c->misses = c->probes = ZERO;
+
+  if(slots > ZERO){
+    while((ONE << c->bits) < slots){
+      c->bits++;
+    }
+    c->slots = (RBCacheSlot*) gfmalloc(((size_t) ONE
+      << c->bits) * sizeof(RBCacheSlot));
+    for(i = ZERO; i < (ONE << c->bits); i++){
+      c->slots[i].node = NULL;
+      c->slots[i].key = ZERO;
+    }
+  }
+  return c;
+}
+
+/* Fibonacci hashing, the top bits of key * 2^32/phi */
+uint32_t RBCache_slot(RBCache* c, int key)
+{
+  if(c->bits == ZERO){
+    return ZERO;
+  }
+  return ((uint32_t) key * RBCACHE_PHI) >>
+    (RBCACHE_WORD - c->bits);
+}
+
+/* Tree walk that counts the nodes it visits */
+RBNode* RBCache_descend(RBCache* c, int key)
+{
+  RBNode *x, *nil = c->tree->nil;
+
+  x = c->tree->root->left;
+  while(x != nil){
+    c->probes++;
+    if(key == x->key){
+      return x;
+    }
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x;
+}
+
+RBNode* RBCache_search(RBCache* c, int key)
+{
+  RBCacheSlot *s;
+
+  if(c->slots == NULL){
+    c->misses++;
+    return RBCache_descend(c, key);
+  }
+  s = &c->slots[RBCache_slot(c, key)];
+  if(s->node != NULL && s->key == key){
+    c->hits++;
+    return s->node;
+  }
+  c->misses++;
+  s->key = key;
+  s->node = RBCache_descend(c, key);
+
+  return s->node;
+}
+
+void RBCache_set(RBCache* c, int key, RBNode* node)
+{
+  RBCacheSlot *s;
+
+  if(c->slots != NULL){
+    s = &c->slots[RBCache_slot(c, key)];
+    s->key = key;
+    s->node = node;
+  }
+}
+
+RBNode* RBCache_insert(RBCache* c, int key)
+{
+  RBNode *node;
+
+  /* the node already holding key if there is one, so one
+  descent either way */
+  node = RBTree_insert(c->tree, key);
+  RBCache_set(c, key, node);
+
+  return node;
+}
+
+bool RBCache_delete(RBCache* c, int key)
+{
+  bool found;
+
+  found = RBTree_delete(c->tree, key);
+  RBCache_set(c, key, c->tree->nil);
+
+  return found;
+}
+
+double RBCache_hitrate(RBCache* c)
+{
+  if(c->hits + c->misses == ZERO){
+    return ZERO;
+  }
+  return (double) c->hits / (c->hits + c->misses);
+}
+
+/* Frees the cache only, the tree is the caller's */
+void RBCache_free(RBCache* c)
+{
+  free(c->slots);
+  free(c);
+}
@@ -0,0 +1,252 @@
+/*********************************************************/
+/* RBHASH.C **********************************************/
+/*********************************************************/
+
+/* Open-addressing hash index kept beside an RBTree, laid
+out as a Swiss table: slots come in groups of 16 with one
+control byte each, EMPTY, DELETED or the top 7 bits of the
+key's hash (h2). A lookup hashes to a group, compares all
+16 control bytes with h2 at once (one SSE2 compare, or two
+64-bit SWAR words where there is no SSE2) and only looks at
+the slots whose byte matched, so a point lookup is usually
+one cache line of control bytes plus one slot, where the
+tree would take a miss per level. Inserts and deletes go
+through here to keep both sides in step; ordered work
+(minimum, successor, heights) still uses the tree. */
+
+#include "ext.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Index an existing tree with room for at least cap keys
+before the first grow */
+RBHash* RBHash_init(RBTree* tree, int cap)
+{
+  RBHash *h;
+  RBNode *x;
+
+  h = (RBHash*) gfmalloc(sizeof(RBHash));
+  h->tree = tree;
+  h->ctrl = NULL;
+  h->slots = NULL;
+  h->size = ZERO;
+  RBHash_grow(h, cap);
+
+  x = RBTree_minimum(tree, tree->root->left);
+  while(x != tree->nil){
+    RBHash_add(h, x->key, x);
+    x = RBTree_next(tree, x);
+  }
+  return h;
+}
+
+/* Fibonacci hash, h2 from the top 7 bits and the group
+from the 32 below them */
+uint64_t RBHash_hash(int key)
+{
+  return (uint64_t) (uint32_t) key * RBHASH_PHI;
+}
+
+/* Bit i set where ctrl[i] equals byte, i < 16. The SWAR
+borrow can also flag a full slot whose h2 is one off a
+real match just below it; the key compare after it throws
+that out, and EMPTY and DELETED are always exact */
+uint32_t RBHash_match(unsigned char* ctrl,
+  unsigned char byte)
+{
+#ifdef __SSE2__
+  __m128i g = _mm_loadu_si128((__m128i*) ctrl);
+
+  return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(g,
+    _mm_set1_epi8((char) byte)));
+#else
+  uint64_t w, x, bits = ZERO;
+  uint32_t m = ZERO;
+  int i;
+
+  for(i = ZERO; i < TWO; i++){
+    memcpy(&w, ctrl + i * RBHASH_WORD, sizeof(w));
+    x = w ^ (RBHASH_LSB * byte);
+    bits = (x - RBHASH_LSB) & ~x & RBHASH_MSB;
+    /* gather the high bit of each byte into 8 bits */
+    m |= (uint32_t) (((bits >> (RBHASH_WORD - ONE)) *
+      RBHASH_GATHER) >> (RBHASH_BITS - RBHASH_WORD))
+      << (i * RBHASH_WORD);
+  }
+  return m;
+#endif
+}
+
+/* Slot holding key, or -1 */
+long RBHash_slot(RBHash* h, int key)
+{
+  uint64_t hv = RBHash_hash(key);
+  unsigned char *ctrl, h2;
+  uint32_t m, g, step;
+  long base;
+  int i;
+
+  h2 = (unsigned char) (hv >> RBHASH_H2SHIFT);
+  g = (uint32_t) (hv >> RBHASH_H1SHIFT) & h->gmask;
+  for(step = ONE; ; step++){
+    base = (long) g * RBHASH_GROUP;
+    ctrl = h->ctrl + base;
+    m = RBHash_match(ctrl, h2);
+    while(m != ZERO){
+      i = __builtin_ctz(m);
+      if(h->slots[base + i].key == key){
+        return base + i;
+      }
+      m &= m - ONE;
+    }
+    /* an empty byte ends the probe, the key would have
+    gone there */
+    if(RBHash_match(ctrl, RBHASH_EMPTY) != ZERO){
+      return -ONE;
+    }
+    /* triangular steps visit every group once */
+    g = (g + step) & h->gmask;
+  }
+}
+
+RBNode* RBHash_search(RBHash* h, int key)
+{
+  long s;
+
+  s = RBHash_slot(h, key);
+  if(s < ZERO){
+    return h->tree->nil;
+  }
+  return h->slots[s].node;
+}
+
+bool RBHash_isin(RBHash* h, int key)
+{
+  return RBHash_slot(h, key) >= ZERO;
+}
+
+/* Index only, key must not be there already */
+void RBHash_add(RBHash* h, int key, RBNode* node)
+{
+  uint64_t hv;
+  unsigned char *ctrl;
+  uint32_t m, g, step;
+  long base;
+  int i;
+
+  if((long) (h->used + ONE) * RBHASH_LOADDEN >
+    ((long) h->gmask + ONE) * RBHASH_GROUP *
+    RBHASH_LOADNUM){
+    RBHash_grow(h, h->size);
+  }
+  hv = RBHash_hash(key);
+  g = (uint32_t) (hv >> RBHASH_H1SHIFT) & h->gmask;
+  for(step = ONE; ; step++){
+    base = (long) g * RBHASH_GROUP;
+    ctrl = h->ctrl + base;
+    m = RBHash_match(ctrl, RBHASH_EMPTY) |
+      RBHash_match(ctrl, RBHASH_DELETED);
+    if(m != ZERO){
+      i = __builtin_ctz(m);
+      if(ctrl[i] == RBHASH_EMPTY){
+        h->used++;
+      }
+      ctrl[i] = (unsigned char) (hv >> RBHASH_H2SHIFT);
+      h->slots[base + i].key = key;
+      h->slots[base + i].node = node;
+      h->size++;
+      return;
+    }
+    g = (g + step) & h->gmask;
+  }
+}
+
+/* Rehash into enough groups for n keys at the load limit,
+dropping the DELETED markers on the way */
+void RBHash_grow(RBHash* h, int n)
+{
+  unsigned char *ctrl = h->ctrl;
+  RBHashSlot *slots = h->slots;
+  long i, old = ZERO, groups = ONE;
+
+  if(ctrl != NULL){
+    old = ((long) h->gmask + ONE) * RBHASH_GROUP;
+  }
+  /* double the live keys, so a table full of tombstones
+  is rebuilt rather than grown without end */
+  while(groups * RBHASH_GROUP * RBHASH_LOADNUM <
+    (long) n * TWO * RBHASH_LOADDEN){
+    groups *= TWO;
+  }
+  h->gmask = (uint32_t) (groups - ONE);
+  h->ctrl = (unsigned char*) gfmalloc((size_t) groups *
+    RBHASH_GROUP);
+  memset(h->ctrl, RBHASH_EMPTY, (size_t) groups *
+    RBHASH_GROUP);
+  h->slots = (RBHashSlot*) gfmalloc((size_t) groups *
+    RBHASH_GROUP * sizeof(RBHashSlot));
+  h->size = h->used = ZERO;
+
+  for(i = ZERO; i < old; i++){
+    if(ctrl[i] < RBHASH_EMPTY){
+      RBHash_add(h, slots[i].key, slots[i].node);
+    }
+  }
+  free(ctrl);
+  free(slots);
+}
+
+/* Insert into the tree and, if new, the index */
+RBNode* RBHash_insert(RBHash* h, int key)
+{
+  RBNode *node;
+
+  node = RBHash_search(h, key);
+  if(node != h->tree->nil){
+    return node;
+  }
+  node = RBTree_insert(h->tree, key);
+  RBHash_add(h, key, node);
+
+  return node;
+}
+
+bool RBHash_delete(RBHash* h, int key)
+{
+  unsigned char *group;
+  long s;
+
+  s = RBHash_slot(h, key);
+  if(s < ZERO){
+    return false;
+  }
+  /* a group with an empty byte never sent a probe on to
+  the next group, so the slot can go back to EMPTY */
+  group = h->ctrl + s - s % RBHASH_GROUP;
+  if(RBHash_match(group, RBHASH_EMPTY) != ZERO){
+    h->ctrl[s] = RBHASH_EMPTY;
+    h->used--;
+  }
+  else {
+    h->ctrl[s] = RBHASH_DELETED;
+  }
+  h->size--;
+
+  return RBTree_delete(h->tree, key);
+}
+
+/* Bytes used by the index alone */
+long RBHash_bytes(RBHash* h)
+{
+  return ((long) h->gmask + ONE) * RBHASH_GROUP *
+    (long) (sizeof(RBHashSlot) + ONE);
+}
+
+/* Frees the index only, the tree is the caller's */
+void RBHash_free(RBHash* h)
+{
+  free(h->ctrl);
+  free(h->slots);
+  free(h);
+}
@@ -0,0 +1,286 @@
+/*********************************************************/
+/* RBIDX.C ***********************************************/
+/*********************************************************/
+
+/* Red-black tree whose nodes live in one contiguous pool
+and refer to each other by 32-bit index instead of by
+pointer. Index 0 is the nil sentinel and the colour of a
+node is kept in the top bit of its parent index, so a node
+is 16 bytes against 32 for an RBNode. As nothing in the
+pool is an address the whole tree can be realloc'd, copied
+or written to disk as is. */
+
+#include "ext.h"
+
+#define PARENT(t, x) ((t)->pool[x].parent & RBIDX_MASK)
+#define ISRED(t, x)  (((t)->pool[x].parent & RBIDX_RED) \
+  != ZERO)
+#define SETRED(t, x) ((t)->pool[x].parent |= RBIDX_RED)
+#define SETBLK(t, x) ((t)->pool[x].parent &= RBIDX_MASK)
+
+RBIdxTree* RBIdx_init(uint32_t cap)
+{
+  RBIdxTree *tree;
+
+  if(cap < TWO){
+    cap = TWO;
+  }
+  tree = (RBIdxTree*) gfmalloc(sizeof(RBIdxTree));
+  tree->pool = (RBIdxNode*) gfmalloc(cap *
+    sizeof(RBIdxNode));
+  tree->cap = cap;
+  tree->root = RBIDX_NIL;
+
+  /* slot 0 is nil: black, and every link points back to
+  itself */
+  tree->pool[RBIDX_NIL].key = ZERO;
+  tree->pool[RBIDX_NIL].parent = RBIDX_NIL;
+  tree->pool[RBIDX_NIL].left = RBIDX_NIL;
+  tree->pool[RBIDX_NIL].right = RBIDX_NIL;
+  tree->size = ONE;
+
+  return tree;
+}
+
+uint32_t RBIdx_newnode(RBIdxTree* tree, int key)
+{
+  uint32_t x;
+  RBIdxNode *node;
+
+  /* double the pool when full, as links are indices the
+  move does not invalidate anything */
+  if(tree->size == tree->cap){
+    if(tree->cap > RBIDX_MASK / TWO){
+      ON_ERROR("RBIdx pool exhausted\n");
+    }
+    tree->cap = tree->cap * TWO;
+    tree->pool = (RBIdxNode*) realloc(tree->pool,
+      tree->cap * sizeof(RBIdxNode));
+    if(tree->pool == NULL){
+      ON_ERROR("Realloc failed\n");
+    }
+  }
+  x = tree->size++;
+  node = &tree->pool[x];
+  node->key = key;
+  node->parent = RBIDX_NIL | RBIDX_RED;
+  node->left = node->right = RBIDX_NIL;
+
+  return x;
+}
+
+/* Re-point x's parent link at p, keeping x's colour
+bit */
+void RBIdx_setparent(RBIdxTree* tree, uint32_t x,
+  uint32_t p)
+{
+  tree->pool[x].parent = (tree->pool[x].parent & RBIDX_RED)
+    | p;
+}
+
+/* Replace x by y in x's parent (or as root) */
+void RBIdx_replace(RBIdxTree* tree, uint32_t x, uint32_t y)
+{
+  uint32_t p = PARENT(tree, x);
+
+  RBIdx_setparent(tree, y, p);
+  if(p == RBIDX_NIL){
+    tree->root = y;
+  }
+  else if(tree->pool[p].left == x){
+    tree->pool[p].left = y;
+  }
+  else {
+    tree->pool[p].right = y;
+  }
+}
+
+/* Same four steps as rotate_left, see diagram in ext.c */
+void RBIdx_rotateleft(RBIdxTree* tree, uint32_t x)
+{
+  RBIdxNode *pool = tree->pool;
+  uint32_t y = pool[x].right;
+
+  pool[x].right = pool[y].left;
+  if(pool[y].left != RBIDX_NIL){
+    RBIdx_setparent(tree, pool[y].left, x);
+  }
+  RBIdx_replace(tree, x, y);
+  pool[y].left = x;
+  RBIdx_setparent(tree, x, y);
+}
+
+/* Same four steps as rotate_right, see diagram in ext.c */
+void RBIdx_rotateright(RBIdxTree* tree, uint32_t y)
+{
+  RBIdxNode *pool = tree->pool;
+  uint32_t x = pool[y].left;
+
+  pool[y].left = pool[x].right;
+  if(pool[x].right != RBIDX_NIL){
+    RBIdx_setparent(tree, pool[x].right, y);
+  }
+  RBIdx_replace(tree, y, x);
+  pool[x].right = y;
+  RBIdx_setparent(tree, y, x);
+}
+
+uint32_t RBIdx_insert(RBIdxTree* tree, int key)
+{
+  uint32_t x, y, z, p, g, uncle;
+
+  /* standard bst descent, duplicates are returned rather
+  than inserted */
+  y = RBIDX_NIL;
+  x = tree->root;
+  while(x != RBIDX_NIL){
+    y = x;
+    if(key < tree->pool[x].key){
+      x = tree->pool[x].left;
+    }
+    else if(key > tree->pool[x].key){
+      x = tree->pool[x].right;
+    }
+    else {
+      return x;
+    }
+  }
+  z = RBIdx_newnode(tree, key);
+  RBIdx_setparent(tree, z, y);
+  if(y == RBIDX_NIL){
+    tree->root = z;
+  }
+  else if(key < tree->pool[y].key){
+    tree->pool[y].left = z;
+  }
+  else {
+    tree->pool[y].right = z;
+  }
+
+  /* RB insert fixup, case by case as in RBTree_insert */
+  x = z;
+  while(ISRED(tree, PARENT(tree, x))){
+    p = PARENT(tree, x);
+    g = PARENT(tree, p);
+    if(p == tree->pool[g].left){
+      uncle = tree->pool[g].right;
+      if(ISRED(tree, uncle)){
+        SETBLK(tree, p);
+        SETBLK(tree, uncle);
+        SETRED(tree, g);
+        x = g;
+      }
+      else {
+        if(x == tree->pool[p].right){
+          x = p;
+          RBIdx_rotateleft(tree, x);
+          p = PARENT(tree, x);
+        }
+        SETBLK(tree, p);
+        SETRED(tree, g);
+        RBIdx_rotateright(tree, g);
+      }
+    }
+    else {
+      uncle = tree->pool[g].left;
+      if(ISRED(tree, uncle)){
+        SETBLK(tree, p);
+        SETBLK(tree, uncle);
+        SETRED(tree, g);
+        x = g;
+      }
+      else {
+        if(x == tree->pool[p].left){
+          x = p;
+          RBIdx_rotateright(tree, x);
+          p = PARENT(tree, x);
+        }
+        SETBLK(tree, p);
+        SETRED(tree, g);
+        RBIdx_rotateleft(tree, g);
+      }
+    }
+  }
+  SETBLK(tree, tree->root);
+
+  return z;
+}
+
+uint32_t RBIdx_search(RBIdxTree* tree, int key)
+{
+  RBIdxNode *pool = tree->pool;
+  uint32_t x = tree->root;
+
+  while(x != RBIDX_NIL && pool[x].key != key){
+    if(key < pool[x].key){
+      x = pool[x].left;
+    }
+    else {
+      x = pool[x].right;
+    }
+  }
+  return x;
+}
+
+int RBIdx_height(RBIdxTree* tree, uint32_t x)
+{
+  int l_height, r_height;
+
+  if(x == RBIDX_NIL){
+    return ZERO;
+  }
+  l_height = RBIdx_height(tree, tree->pool[x].left);
+  r_height = RBIdx_height(tree, tree->pool[x].right);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+/* Bytes held by the tree, pool capacity included */
+size_t RBIdx_bytes(RBIdxTree* tree)
+{
+  return sizeof(RBIdxTree) + tree->cap *
+    sizeof(RBIdxNode);
+}
+
+/* Serialise as header then the used part of the pool,
+no fix-up of links is needed on the way back in */
+void RBIdx_save(RBIdxTree* tree, FILE* fp)
+{
+  if(fwrite(&tree->size, sizeof(uint32_t), ONE, fp)
+      != ONE ||
+    fwrite(&tree->root, sizeof(uint32_t), ONE, fp)
+      != ONE ||
+    fwrite(tree->pool, sizeof(RBIdxNode), tree->size, fp)
+      != tree->size){
+    ON_ERROR("RBIdx_save write failed\n");
+  }
+}
+
+RBIdxTree* RBIdx_load(FILE* fp)
+{
+  RBIdxTree *tree;
+  uint32_t size, root;
+
+  if(fread(&size, sizeof(uint32_t), ONE, fp) != ONE ||
+    fread(&root, sizeof(uint32_t), ONE, fp) != ONE ||
+    size < ONE || root >= size){
+    ON_ERROR("RBIdx_load bad header\n");
+  }
+  tree = RBIdx_init(size);
+  if(fread(tree->pool, sizeof(RBIdxNode), size, fp)
+    != size){
+    ON_ERROR("RBIdx_load short read\n");
+  }
+  tree->size = size;
+  tree->root = root;
+
+  return tree;
+}
+
+void RBIdx_free(RBIdxTree* tree)
+{
+  free(tree->pool);
+  free(tree);
+}
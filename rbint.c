@@ -0,0 +1,10 @@
+/*********************************************************/
+/* RBINT.C ***********************************************/
+/*********************************************************/
+
+/* int instance of the red-black tree template, compared
+inline with RB_CMPNUM */
+
+#include "ext.h"
+
+DEFINE_RBTREE(RBInt, int, RB_CMPNUM);
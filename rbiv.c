@@ -0,0 +1,180 @@
+/*********************************************************/
+/* RBIV.C ************************************************/
+/*********************************************************/
+
+/* Interval tree on top of RBTree. Intervals are keyed by
+their lo end, those sharing a lo share one RBIVNode, and
+every node keeps max, the largest hi in its subtree, right
+through the rotations by RBTree's augment hook. A query
+for the intervals meeting [a, b] skips any subtree whose
+max is below a and anything right of a node whose lo is
+past b, so it costs O(log n + k) for k answers, which come
+out in order of lo. */
+
+#include "ext.h"
+
+RBTree* RBIV_init(void)
+{
+  RBTree *tree;
+
+  tree = RBTree_init();
+  tree->augment = RBIV_augment;
+
+  return tree;
+}
+
+int RBIV_max(RBTree* tree, RBNode* x)
+{
+  if(x == tree->nil){
+    return INT_MIN;
+  }
+  return ((RBIVNode*) x)->max;
+}
+
+void RBIV_augment(RBTree* tree, RBNode* x)
+{
+  RBIVNode *v = (RBIVNode*) x;
+  int l, r;
+
+  l = RBIV_max(tree, x->left);
+  r = RBIV_max(tree, x->right);
+  v->max = v->his[ZERO];
+  if(l > v->max){
+    v->max = l;
+  }
+  if(r > v->max){
+    v->max = r;
+  }
+}
+
+/* Add [lo, hi], a repeat is kept as a second copy */
+void RBIV_insert(RBTree* tree, int lo, int hi)
+{
+  RBNode *x;
+  RBIVNode *v;
+  int i;
+
+  if(lo > hi){
+    ON_ERROR("Interval to RBIV_insert has lo > hi\n");
+  }
+  x = RBTree_search(tree, lo);
+  if(x == tree->nil){
+    v = (RBIVNode*) gfmalloc(sizeof(RBIVNode));
+    v->node.key = lo;
+    v->his = (int*) gfmalloc(sizeof(int));
+    v->his[ZERO] = v->max = hi;
+    v->count = v->cap = ONE;
+    RBTree_insertnode(tree, &v->node);
+    return;
+  }
+
+  v = (RBIVNode*) x;
+  if(v->count == v->cap){
+    v->cap *= TWO;
+    v->his = (int*) realloc(v->his, (size_t) v->cap *
+      sizeof(int));
+    if(v->his == NULL){
+      ON_ERROR("Realloc failed\n");
+    }
+  }
+  /* keep his largest first */
+  for(i = v->count; i > ZERO && v->his[i - ONE] < hi; i--){
+    v->his[i] = v->his[i - ONE];
+  }
+  v->his[i] = hi;
+  v->count++;
+  RBTree_augmentup(tree, x);
+}
+
+/* Take out one copy of [lo, hi], the node goes with the
+last interval starting at lo */
+bool RBIV_remove(RBTree* tree, int lo, int hi)
+{
+  RBNode *x;
+  RBIVNode *v;
+  int i;
+
+  x = RBTree_search(tree, lo);
+  if(x == tree->nil){
+    return false;
+  }
+  v = (RBIVNode*) x;
+  i = ZERO;
+  while(i < v->count && v->his[i] != hi){
+    i++;
+  }
+  if(i == v->count){
+    return false;
+  }
+  if(v->count == ONE){
+    free(v->his);
+    return RBTree_delete(tree, lo);
+  }
+  for(v->count--; i < v->count; i++){
+    v->his[i] = v->his[i + ONE];
+  }
+  RBTree_augmentup(tree, x);
+
+  return true;
+}
+
+/* Intervals holding t, see RBIV_overlap */
+int RBIV_stab(RBTree* tree, int t, Interval* out, int max)
+{
+  return RBIV_overlap(tree, t, t, out, max);
+}
+
+/* Number of intervals meeting [a, b]; the first max of
+them by lo go into out (max 0 just counts) */
+int RBIV_overlap(RBTree* tree, int a, int b, Interval* out,
+  int max)
+{
+  int count = ZERO;
+
+  RBIV_collect(tree, tree->root->left, a, b, out, max,
+    &count);
+  return count;
+}
+
+/* [lo, hi] meets [a, b] when lo <= b and hi >= a */
+void RBIV_collect(RBTree* tree, RBNode* x, int a, int b,
+  Interval* out, int max, int* count)
+{
+  RBIVNode *v;
+  int i;
+
+  /* no hi in here reaches a */
+  if(x == tree->nil || RBIV_max(tree, x) < a){
+    return;
+  }
+  RBIV_collect(tree, x->left, a, b, out, max, count);
+  /* this lo and every one to the right is past b */
+  if(x->key > b){
+    return;
+  }
+  v = (RBIVNode*) x;
+  for(i = ZERO; i < v->count && v->his[i] >= a; i++){
+    if(*count < max){
+      out[*count].lo = x->key;
+      out[*count].hi = v->his[i];
+    }
+    (*count)++;
+  }
+  RBIV_collect(tree, x->right, a, b, out, max, count);
+}
+
+void RBIV_free(RBTree* tree)
+{
+  RBIV_freehis(tree, tree->root->left);
+  RBTree_free(tree);
+}
+
+/* The hi arrays, RBTree_free takes the nodes */
+void RBIV_freehis(RBTree* tree, RBNode* x)
+{
+  if(x != tree->nil){
+    RBIV_freehis(tree, x->left);
+    RBIV_freehis(tree, x->right);
+    free(((RBIVNode*) x)->his);
+  }
+}
@@ -0,0 +1,9 @@
+/*********************************************************/
+/* RBMAP.C ***********************************************/
+/*********************************************************/
+
+/* int -> long instance of the red-black map template */
+
+#include "ext.h"
+
+DEFINE_RBMAP(RBMap, int, long, RB_CMPNUM);
@@ -0,0 +1,148 @@
+/*********************************************************/
+/* RBMS.C ************************************************/
+/*********************************************************/
+
+/* Multiset on top of RBTree. Each distinct key has one
+RBMSNode holding how many copies there are, so inserting a
+key that is already present bumps its count and the weights
+on the way back up: O(h) with no allocation. weight (the
+number of copies in a subtree) is kept right through the
+rotations by RBTree's augment hook, and gives rank and
+select that count every copy. */
+
+#include "ext.h"
+
+RBTree* RBMS_init(void)
+{
+  RBTree *tree;
+
+  tree = RBTree_init();
+  tree->augment = RBMS_augment;
+
+  return tree;
+}
+
+int RBMS_weight(RBTree* tree, RBNode* x)
+{
+  if(x == tree->nil){
+    return ZERO;
+  }
+  return ((RBMSNode*) x)->weight;
+}
+
+void RBMS_augment(RBTree* tree, RBNode* x)
+{
+  RBMSNode *m = (RBMSNode*) x;
+
+  m->weight = m->count + RBMS_weight(tree, x->left) +
+    RBMS_weight(tree, x->right);
+}
+
+/* Add one copy of key, returns how many there are now */
+int RBMS_insert(RBTree* tree, int key)
+{
+  RBNode *x;
+  RBMSNode *m;
+
+  x = RBTree_search(tree, key);
+  if(x != tree->nil){
+    m = (RBMSNode*) x;
+    m->count++;
+    for(; x != tree->root; x = x->parent){
+      ((RBMSNode*) x)->weight++;
+    }
+    return m->count;
+  }
+  m = (RBMSNode*) gfmalloc(sizeof(RBMSNode));
+  m->node.key = key;
+  m->count = m->weight = ONE;
+  RBTree_insertnode(tree, &m->node);
+
+  return ONE;
+}
+
+/* Remove one copy of key, the node goes with the last */
+bool RBMS_remove(RBTree* tree, int key)
+{
+  RBNode *x;
+
+  x = RBTree_search(tree, key);
+  if(x == tree->nil){
+    return false;
+  }
+  if(((RBMSNode*) x)->count == ONE){
+    return RBTree_delete(tree, key);
+  }
+  ((RBMSNode*) x)->count--;
+  for(; x != tree->root; x = x->parent){
+    ((RBMSNode*) x)->weight--;
+  }
+  return true;
+}
+
+int RBMS_count(RBTree* tree, int key)
+{
+  RBNode *x;
+
+  x = RBTree_search(tree, key);
+  if(x == tree->nil){
+    return ZERO;
+  }
+  return ((RBMSNode*) x)->count;
+}
+
+/* Copies of all keys together */
+int RBMS_size(RBTree* tree)
+{
+  return RBMS_weight(tree, tree->root->left);
+}
+
+/* Copies of keys less than key */
+int RBMS_rank(RBTree* tree, int key)
+{
+  RBNode *x, *nil = tree->nil;
+  int rank = ZERO;
+
+  x = tree->root->left;
+  while(x != nil){
+    if(key < x->key){
+      x = x->left;
+    }
+    else if(key > x->key){
+      rank += RBMS_weight(tree, x->left) +
+        ((RBMSNode*) x)->count;
+      x = x->right;
+    }
+    else {
+      return rank + RBMS_weight(tree, x->left);
+    }
+  }
+  return rank;
+}
+
+/* Key of copy i (from 0) in sorted order */
+int RBMS_select(RBTree* tree, int i)
+{
+  RBNode *x, *nil = tree->nil;
+  int left;
+
+  if(i < ZERO || i >= RBMS_size(tree)){
+    ON_ERROR("Index to RBMS_select out of range\n");
+  }
+  x = tree->root->left;
+  while(x != nil){
+    left = RBMS_weight(tree, x->left);
+    if(i < left){
+      x = x->left;
+    }
+    else if(i < left + ((RBMSNode*) x)->count){
+      return x->key;
+    }
+    else {
+      i -= left + ((RBMSNode*) x)->count;
+      x = x->right;
+    }
+  }
+  ON_ERROR("RBMS_select weights are inconsistent\n");
+  return ZERO;
+}
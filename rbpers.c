@@ -0,0 +1,218 @@
+/*********************************************************/
+/* RBPERS.C **********************************************/
+/*********************************************************/
+
+/* Persistent red-black tree. Nodes are never changed once
+they are reachable from a published root: an insert copies
+the path from the root down to the new leaf (Okasaki's
+functional insert) and the copies share every subtree off
+that path with the old version. Taking a snapshot is then
+just holding on to a root, O(1), and each insert allocates
+O(log n) nodes.
+
+Every node counts the parents and snapshots pointing at it
+(refs); a version is given up with RBP_release, which frees
+the nodes that no other version still uses. The counts are
+changed with atomic adds so a reader may release its
+snapshot on another thread while the writer carries on;
+taking the snapshot (reading tree->root) has to be ordered
+with the writer's inserts by the caller. */
+
+#include "ext.h"
+
+RBPTree* RBP_init(void)
+{
+  RBPTree *tree;
+
+  tree = (RBPTree*) gfmalloc(sizeof(RBPTree));
+  tree->root = NULL;
+  tree->size = ZERO;
+  tree->allocs = ZERO;
+
+  return tree;
+}
+
+/* Takes over one reference each to left and right */
+RBPNode* RBP_newnode(RBPTree* tree, rdblk colour, int key,
+  RBPNode* left, RBPNode* right)
+{
+  RBPNode *node;
+
+  node = (RBPNode*) gfmalloc(sizeof(RBPNode));
+  node->colour = colour;
+  node->key = key;
+  node->refs = ONE;
+  node->left = left;
+  node->right = right;
+  tree->allocs++;
+
+  return node;
+}
+
+RBPNode* RBP_retain(RBPNode* node)
+{
+  if(node != NULL){
+    __sync_add_and_fetch(&node->refs, ONE);
+  }
+  return node;
+}
+
+/* Drop one reference, freeing the node and releasing its
+children when it was the last */
+void RBP_release(RBPNode* node)
+{
+  RBPNode *right;
+
+  /* loop down the right spine, recurse on the left */
+  while(node != NULL &&
+    __sync_sub_and_fetch(&node->refs, ONE) == ZERO){
+    RBP_release(node->left);
+    right = node->right;
+    free(node);
+    node = right;
+  }
+}
+
+bool RBP_isred(RBPNode* node)
+{
+  return node != NULL && node->colour == red;
+}
+
+/* x is a black node fresh from RBP_ins and may have a red
+child with a red child of its own (only ever on the copied
+path, so x, y and z are all new and unshared and can be
+relinked in place). Okasaki's four cases all end as
+
+        [y]
+       /   \
+     #x#   #z#
+
+with the four subtrees below in key order */
+RBPNode* RBP_balance(RBPNode* x)
+{
+  RBPNode *y, *z, *t;
+
+  if(RBP_isred(x->left) && RBP_isred(x->left->left)){
+    y = x->left;
+    z = y->left;
+    x->left = y->right;
+    y->left = z;
+    y->right = x;
+  }
+  else if(RBP_isred(x->left) && RBP_isred(x->left->right)){
+    t = x->left;
+    y = t->right;
+    t->right = y->left;
+    x->left = y->right;
+    y->left = t;
+    y->right = x;
+  }
+  else if(RBP_isred(x->right) &&
+    RBP_isred(x->right->left)){
+    t = x->right;
+    y = t->left;
+    t->left = y->right;
+    x->right = y->left;
+    y->left = x;
+    y->right = t;
+  }
+  else if(RBP_isred(x->right) &&
+    RBP_isred(x->right->right)){
+    y = x->right;
+    x->right = y->left;
+    y->left = x;
+  }
+  else {
+    return x;
+  }
+  y->colour = red;
+  y->left->colour = black;
+  y->right->colour = black;
+
+  return y;
+}
+
+/* Copy of x with key added, key must not be in x */
+RBPNode* RBP_ins(RBPTree* tree, RBPNode* x, int key)
+{
+  RBPNode *node;
+
+  if(x == NULL){
+    return RBP_newnode(tree, red, key, NULL, NULL);
+  }
+  if(key < x->key){
+    node = RBP_newnode(tree, x->colour, x->key,
+      RBP_ins(tree, x->left, key), RBP_retain(x->right));
+  }
+  else {
+    node = RBP_newnode(tree, x->colour, x->key,
+      RBP_retain(x->left), RBP_ins(tree, x->right, key));
+  }
+  if(node->colour == black){
+    return RBP_balance(node);
+  }
+  return node;
+}
+
+/* Make a new current version with key in it, the old one
+lives on in any snapshot taken of it */
+bool RBP_insert(RBPTree* tree, int key)
+{
+  RBPNode *root;
+
+  if(RBP_search(tree->root, key)){
+    return false;
+  }
+  root = RBP_ins(tree, tree->root, key);
+  root->colour = black;
+  RBP_release(tree->root);
+  tree->root = root;
+  tree->size++;
+
+  return true;
+}
+
+/* Current version, the caller must RBP_release it */
+RBPNode* RBP_snapshot(RBPTree* tree)
+{
+  return RBP_retain(tree->root);
+}
+
+/* Works on any version */
+bool RBP_search(RBPNode* root, int key)
+{
+  RBPNode *x = root;
+
+  while(x != NULL && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x != NULL;
+}
+
+int RBP_height(RBPNode* node)
+{
+  int l_height, r_height;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  l_height = RBP_height(node->left);
+  r_height = RBP_height(node->right);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+/* Releases the current version, nodes still in snapshots
+stay until those are released */
+void RBP_free(RBPTree* tree)
+{
+  RBP_release(tree->root);
+  free(tree);
+}
@@ -0,0 +1,334 @@
+/*********************************************************/
+/* RBSHARD.C *********************************************/
+/*********************************************************/
+
+/* Ordered set split by key range over k RBTrees, each
+behind its own mutex, so writers in different ranges never
+wait for one another where a single RBTree has every
+insert go through the one root. The bounds start at
+quantiles of a sample of the keys (or an even split of the
+ints with no sample) and RBShard_rebalance moves them to
+the quantiles of the keys held, with the set still in use.
+
+A key is routed by binary search of the bounds with no
+lock taken and then checked against the bounds again once
+its shard is locked: a rebalance holds every lock while it
+moves them, so a route that raced with one is just tried
+again. Locks are only ever taken one at a time, or all in
+order by the rebalance, so there is no deadlock. A range
+scan locks one shard at a time; each shard's part of it is
+consistent but the whole is not one snapshot. */
+
+#include "ext.h"
+
+/* sample need not be sorted, n = 0 for an even split */
+RBShards* RBShard_init(int k, int* sample, int n)
+{
+  RBShards *s;
+  int *sorted = NULL, i;
+
+  if(k <= ZERO){
+    ON_ERROR("Shards to RBShard_init is <= 0\n");
+  }
+  s = (RBShards*) gfmalloc(sizeof(RBShards));
+  s->k = k;
+  s->shards = (RBShard*) gfmalloc((size_t) k *
+    sizeof(RBShard));
+  s->bounds = (int*) gfmalloc((size_t) k * sizeof(int));
+  for(i = ZERO; i < k; i++){
+    pthread_mutex_init(&s->shards[i].lock, NULL);
+    s->shards[i].tree = RBTree_init();
+    s->shards[i].size = ZERO;
+  }
+
+  if(n > ZERO){
+    sorted = (int*) gfmalloc((size_t) n * sizeof(int));
+    memcpy(sorted, sample, (size_t) n * sizeof(int));
+    qsort(sorted, (size_t) n, sizeof(int),
+      RBShard_compare);
+  }
+  RBShard_setbounds(s, sorted, n);
+  free(sorted);
+
+  return s;
+}
+
+/* Bounds at the k-quantiles of sorted[0..n-1], or evenly
+over the ints when n is 0. Equal quantiles leave a shard
+with nothing to hold, which routing never picks */
+void RBShard_setbounds(RBShards* s, int* sorted, int n)
+{
+  double span;
+  int i, b;
+
+  span = (double) INT_MAX - (double) INT_MIN + ONE;
+  s->bounds[ZERO] = INT_MIN;
+  for(i = ONE; i < s->k; i++){
+    if(n > ZERO){
+      b = sorted[(long) i * n / s->k];
+    }
+    else {
+      b = (int) ((double) INT_MIN + span * i / s->k);
+    }
+    /* RBShard_lock reads these without a lock */
+    __atomic_store_n(&s->bounds[i], b, __ATOMIC_RELAXED);
+  }
+}
+
+int RBShard_compare(const void* a, const void* b)
+{
+  int x = *(const int*) a, y = *(const int*) b;
+
+  return (x > y) - (x < y);
+}
+
+/* Index of the shard holding key's range, locked; the
+caller unlocks it */
+int RBShard_lock(RBShards* s, int key)
+{
+  int lo, hi, mid;
+
+  for(;;){
+    /* last shard whose first key is <= key */
+    lo = ZERO;
+    hi = s->k - ONE;
+    while(lo < hi){
+      mid = lo + (hi - lo + ONE) / TWO;
+      if(__atomic_load_n(&s->bounds[mid],
+        __ATOMIC_RELAXED) <= key){
+        lo = mid;
+      }
+      else {
+        hi = mid - ONE;
+      }
+    }
+    pthread_mutex_lock(&s->shards[lo].lock);
+    /* still right, or a rebalance moved the bounds */
+    if(s->bounds[lo] <= key && (lo == s->k - ONE ||
+      key < s->bounds[lo + ONE])){
+      return lo;
+    }
+    pthread_mutex_unlock(&s->shards[lo].lock);
+  }
+}
+
+/* true if key was not there; the node is allocated before
+the lock is taken so the shard is held only for the tree */
+bool RBShard_insert(RBShards* s, int key)
+{
+  RBShard *sh;
+  RBNode *z, *x;
+
+  z = (RBNode*) gfmalloc(sizeof(RBNode));
+  z->key = key;
+  sh = &s->shards[RBShard_lock(s, key)];
+  x = RBTree_insertnode(sh->tree, z);
+  if(x == z){
+    sh->size++;
+  }
+  pthread_mutex_unlock(&sh->lock);
+
+  if(x != z){
+    free(z);
+    return false;
+  }
+  return true;
+}
+
+bool RBShard_search(RBShards* s, int key)
+{
+  RBShard *sh;
+  bool found;
+
+  sh = &s->shards[RBShard_lock(s, key)];
+  found = RBTree_search(sh->tree, key) != sh->tree->nil;
+  pthread_mutex_unlock(&sh->lock);
+
+  return found;
+}
+
+bool RBShard_delete(RBShards* s, int key)
+{
+  RBShard *sh;
+  bool found;
+
+  sh = &s->shards[RBShard_lock(s, key)];
+  found = RBTree_delete(sh->tree, key);
+  if(found){
+    sh->size--;
+  }
+  pthread_mutex_unlock(&sh->lock);
+
+  return found;
+}
+
+/* Keys from lo to hi inclusive into out in order, at most
+max of them; returns how many */
+int RBShard_range(RBShards* s, int lo, int hi, int* out,
+  int max)
+{
+  RBShard *sh;
+  RBNode *x;
+  int i, next = lo, count = ZERO;
+  bool last = false;
+
+  while(!last && next <= hi && count < max){
+    i = RBShard_lock(s, next);
+    sh = &s->shards[i];
+    x = RBTree_lowerbound(sh->tree, next);
+    while(x != sh->tree->nil && x->key <= hi &&
+      count < max){
+      out[count++] = x->key;
+      x = RBTree_next(sh->tree, x);
+    }
+    /* the next shard starts where this one ends, read
+    before the unlock while the bounds cannot move */
+    last = i == s->k - ONE;
+    if(!last){
+      next = s->bounds[i + ONE];
+    }
+    pthread_mutex_unlock(&sh->lock);
+  }
+  return count;
+}
+
+long RBShard_size(RBShards* s)
+{
+  long size = ZERO;
+  int i;
+
+  for(i = ZERO; i < s->k; i++){
+    pthread_mutex_lock(&s->shards[i].lock);
+    size += s->shards[i].size;
+    pthread_mutex_unlock(&s->shards[i].lock);
+  }
+  return size;
+}
+
+/* Keys in the fullest shard, k times the mean when the
+bounds suit the keys */
+long RBShard_largest(RBShards* s)
+{
+  long largest = ZERO;
+  int i;
+
+  for(i = ZERO; i < s->k; i++){
+    pthread_mutex_lock(&s->shards[i].lock);
+    if(s->shards[i].size > largest){
+      largest = s->shards[i].size;
+    }
+    pthread_mutex_unlock(&s->shards[i].lock);
+  }
+  return largest;
+}
+
+/* Move the bounds to the quantiles of the keys held and
+rebuild each shard's tree from its new keys, which come
+out in order and so go in through a finger. Every lock is
+held throughout, other threads wait and then route again */
+void RBShard_rebalance(RBShards* s)
+{
+  RBShard *sh;
+  RBNode *x;
+  RBFinger f;
+  int *keys, i, j;
+  long n = ZERO;
+
+  for(i = ZERO; i < s->k; i++){
+    pthread_mutex_lock(&s->shards[i].lock);
+    n += s->shards[i].size;
+  }
+
+  keys = (int*) gfmalloc((size_t) (n + ONE) *
+    sizeof(int));
+  n = ZERO;
+  for(i = ZERO; i < s->k; i++){
+    sh = &s->shards[i];
+    x = RBTree_minimum(sh->tree, sh->tree->root->left);
+    while(x != sh->tree->nil){
+      keys[n++] = x->key;
+      x = RBTree_next(sh->tree, x);
+    }
+    RBTree_free(sh->tree);
+    sh->tree = RBTree_init();
+    sh->size = ZERO;
+  }
+  RBShard_setbounds(s, keys, (int) n);
+
+  i = ZERO;
+  sh = &s->shards[i];
+  RBFinger_init(sh->tree, &f);
+  for(j = ZERO; j < n; j++){
+    while(i < s->k - ONE &&
+      keys[j] >= s->bounds[i + ONE]){
+      sh = &s->shards[++i];
+      RBFinger_init(sh->tree, &f);
+    }
+    RBTree_insertfinger(sh->tree, &f, keys[j]);
+    sh->size++;
+  }
+  free(keys);
+
+  for(i = s->k - ONE; i >= ZERO; i--){
+    pthread_mutex_unlock(&s->shards[i].lock);
+  }
+}
+
+void* RBShard_worker(void* arg)
+{
+  RBShardJob *job = (RBShardJob*) arg;
+  int i;
+
+  for(i = ZERO; i < job->n; i++){
+    RBShard_insert(job->s, job->keys[i]);
+  }
+  return NULL;
+}
+
+/* keys[0..n-1] inserted by threads threads, each taking an
+equal slice */
+void RBShard_insertall(RBShards* s, int* keys, int n,
+  int threads)
+{
+  pthread_t *tid;
+  RBShardJob *jobs;
+  int t, from;
+
+  if(threads <= ZERO){
+    ON_ERROR("Threads to RBShard_insertall is <= 0\n");
+  }
+  tid = (pthread_t*) gfmalloc((size_t) threads *
+    sizeof(pthread_t));
+  jobs = (RBShardJob*) gfmalloc((size_t) threads *
+    sizeof(RBShardJob));
+  for(t = ZERO; t < threads; t++){
+    from = (int) ((long) t * n / threads);
+    jobs[t].s = s;
+    jobs[t].keys = keys + from;
+    jobs[t].n = (int) ((long) (t + ONE) * n / threads) -
+      from;
+    if(pthread_create(&tid[t], NULL, RBShard_worker,
+      &jobs[t]) != ZERO){
+      ON_ERROR("RBShard_insertall could not start a "
+        "thread\n");
+    }
+  }
+  for(t = ZERO; t < threads; t++){
+    pthread_join(tid[t], NULL);
+  }
+  free(tid);
+  free(jobs);
+}
+
+void RBShard_free(RBShards* s)
+{
+  int i;
+
+  for(i = ZERO; i < s->k; i++){
+    pthread_mutex_destroy(&s->shards[i].lock);
+    RBTree_free(s->shards[i].tree);
+  }
+  free(s->shards);
+  free(s->bounds);
+  free(s);
+}
@@ -0,0 +1,153 @@
+/*********************************************************/
+/* RBSTR.C ***********************************************/
+/*********************************************************/
+
+/* String keys in the red-black template. bst.c holding
+strings compares by calling strcmp through a function
+pointer on node->data, a load from another cache line
+at every level. RBStr instead keeps in the node the first
+STR_PREFIX bytes of the key packed big-endian into an
+unsigned long, with the length, so most compares are one
+integer compare on the node itself and the text is only
+read when two prefixes are equal. The text is copied
+byte-tight into chunks of an Arena and goes with it in one
+go. RBStrPtr is the bst.c way, for the benchmark. */
+
+#include "ext.h"
+
+DEFINE_RBTREE(RBStr, StrKey, StrKey_compare);
+
+/* Not static, so the compiler cannot see it is always
+strcmp and has to call through it as bst.c does */
+int (*RBStrPtr_compare)(const char*, const char*) = strcmp;
+#define RBSTRPTR_CMP(a, b) RBStrPtr_compare(a, b)
+
+DEFINE_RBTREE(RBStrPtr, const char*, RBSTRPTR_CMP);
+
+/* Key for s, pointing at s itself */
+StrKey StrKey_make(const char* s)
+{
+  StrKey k;
+  int i;
+
+  k.str = s;
+  k.len = (int) strlen(s);
+  k.prefix = ZERO;
+  /* short keys are padded with 0, below every char */
+  for(i = ZERO; i < STR_PREFIX; i++){
+    k.prefix <<= CHAR_BIT;
+    if(i < k.len){
+      k.prefix |= (unsigned char) s[i];
+    }
+  }
+  return k;
+}
+
+/* strcmp order */
+int StrKey_compare(StrKey a, StrKey b)
+{
+  if(a.prefix != b.prefix){
+    return a.prefix < b.prefix ? -ONE : ONE;
+  }
+  /* the same prefix with a 0 in it is the same string */
+  if(a.len < STR_PREFIX){
+    return ZERO;
+  }
+  return strcmp(a.str + STR_PREFIX, b.str + STR_PREFIX);
+}
+
+StrTree* StrTree_init(void)
+{
+  StrTree *t;
+
+  t = (StrTree*) gfmalloc(sizeof(StrTree));
+  t->tree = RBStr_init();
+  t->keys = Arena_init(STR_BLOCK, ARENA_HUGE, ZERO);
+  t->text = NULL;
+  t->left = ZERO;
+  t->bytes = ZERO;
+
+  return t;
+}
+
+/* Copy of s[0..len] in the arena. Keys are packed end to
+end in STR_CHUNK pieces, not one Arena_alloc each, which
+would round every key up to ARENA_ALIGN */
+char* StrTree_copy(StrTree* t, const char* s, int len)
+{
+  size_t size = (size_t) len + ONE;
+  char *p;
+
+  if(size > STR_CHUNK){
+    p = (char*) Arena_alloc(t->keys, size);
+  }
+  else {
+    if(size > t->left){
+      t->text = (char*) Arena_alloc(t->keys, STR_CHUNK);
+      t->left = STR_CHUNK;
+    }
+    p = t->text;
+    t->text += size;
+    t->left -= size;
+  }
+  memcpy(p, s, size);
+  t->bytes += (long) size;
+
+  return p;
+}
+
+/* true if s was not there; s is copied, the caller keeps
+it */
+bool StrTree_insert(StrTree* t, const char* s)
+{
+  RBStr_node *x;
+  int size = t->tree->size;
+
+  x = RBStr_insert(t->tree, StrKey_make(s));
+  if(t->tree->size == size){
+    return false;
+  }
+  x->key.str = StrTree_copy(t, s, x->key.len);
+  return true;
+}
+
+bool StrTree_search(StrTree* t, const char* s)
+{
+  return RBStr_search(t->tree, StrKey_make(s)) != NULL;
+}
+
+void StrTree_free(StrTree* t)
+{
+  RBStr_free(t->tree);
+  Arena_free(t->keys);
+  free(t);
+}
+
+/* RBStrPtr_insert with s copied to its own block, as
+bst_insert copies the data */
+bool RBStrPtr_add(RBStrPtr* tree, const char* s)
+{
+  RBStrPtr_node *x;
+  char *copy;
+  int size = tree->size;
+
+  x = RBStrPtr_insert(tree, s);
+  if(tree->size == size){
+    return false;
+  }
+  copy = (char*) gfmalloc(strlen(s) + ONE);
+  strcpy(copy, s);
+  x->key = copy;
+  return true;
+}
+
+void RBStrPtr_freekeys(RBStrPtr* tree)
+{
+  RBStrPtr_node *x;
+
+  for(x = RBStrPtr_first(tree); x != NULL;
+    x = RBStrPtr_next(x)){
+    free((char*) x->key);
+  }
+  RBStrPtr_free(tree);
+}
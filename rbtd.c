@@ -0,0 +1,240 @@
+/*********************************************************/
+/* RBTD.C ************************************************/
+/*********************************************************/
+
+/* Top-down red-black tree. Insert and delete fix colours
+and rotate on the way down (the red node is pushed ahead
+of the search), so each pass touches the path once and no
+node needs a parent pointer. Children are kept as link[2]
+so that the symmetric cases share code, link[dir] with
+dir = LEFT/RIGHT. */
+
+#include "ext.h"
+
+RBTDTree* RBTD_init(void)
+{
+  RBTDTree *tree;
+
+  tree = (RBTDTree*) gfmalloc(sizeof(RBTDTree));
+  tree->root = NULL;
+
+  return tree;
+}
+
+RBTDNode* RBTD_newnode(int key)
+{
+  RBTDNode *node;
+
+  node = (RBTDNode*) gfmalloc(sizeof(RBTDNode));
+  node->key = key;
+  node->colour = red;
+  node->link[LEFT] = node->link[RIGHT] = NULL;
+
+  return node;
+}
+
+bool RBTD_isred(RBTDNode* node)
+{
+  return node != NULL && node->colour == red;
+}
+
+/* Rotate root away from dir, old root goes red and the
+child that replaces it goes black */
+RBTDNode* RBTD_single(RBTDNode* root, int dir)
+{
+  RBTDNode *save = root->link[!dir];
+
+  root->link[!dir] = save->link[dir];
+  save->link[dir] = root;
+  root->colour = red;
+  save->colour = black;
+
+  return save;
+}
+
+/* Rotate the child first for the inside (zig-zag) case */
+RBTDNode* RBTD_double(RBTDNode* root, int dir)
+{
+  root->link[!dir] = RBTD_single(root->link[!dir], !dir);
+  return RBTD_single(root, dir);
+}
+
+bool RBTD_insert(RBTDTree* tree, int key)
+{
+  /* head is a false root so the real root has a parent */
+  RBTDNode head = {black, ZERO, {NULL, NULL}};
+  RBTDNode *g, *t, *p, *q;
+  int dir = LEFT, last = LEFT, dir2;
+  bool inserted = false;
+
+  if(tree->root == NULL){
+    tree->root = RBTD_newnode(key);
+    tree->root->colour = black;
+    return true;
+  }
+
+  t = &head;
+  g = p = NULL;
+  q = t->link[RIGHT] = tree->root;
+
+  /* walk down with q, parent p, grandparent g and great-
+  grandparent t */
+  for(;;){
+    if(q == NULL){
+      p->link[dir] = q = RBTD_newnode(key);
+      inserted = true;
+    }
+    /* colour flip, a black node with two red children
+    becomes red with two black */
+    else if(RBTD_isred(q->link[LEFT]) &&
+      RBTD_isred(q->link[RIGHT])){
+      q->colour = red;
+      q->link[LEFT]->colour = black;
+      q->link[RIGHT]->colour = black;
+    }
+    /* red violation from the flip or the new node, fix by
+    rotating at g */
+    if(RBTD_isred(q) && RBTD_isred(p)){
+      dir2 = t->link[RIGHT] == g;
+      if(q == p->link[last]){
+        t->link[dir2] = RBTD_single(g, !last);
+      }
+      else {
+        t->link[dir2] = RBTD_double(g, !last);
+      }
+    }
+    if(q->key == key){
+      break;
+    }
+    last = dir;
+    dir = q->key < key;
+    if(g != NULL){
+      t = g;
+    }
+    g = p;
+    p = q;
+    q = q->link[dir];
+  }
+
+  tree->root = head.link[RIGHT];
+  tree->root->colour = black;
+
+  return inserted;
+}
+
+bool RBTD_delete(RBTDTree* tree, int key)
+{
+  RBTDNode head = {black, ZERO, {NULL, NULL}};
+  RBTDNode *q, *p, *g, *s, *f = NULL;
+  int dir = RIGHT, last = RIGHT, dir2;
+
+  if(tree->root == NULL){
+    return false;
+  }
+
+  q = &head;
+  g = p = NULL;
+  q->link[RIGHT] = tree->root;
+
+  /* walk down to the in-order predecessor of key (or key
+  itself if it is a leaf), making sure the next node is
+  red so that removing it breaks no black height */
+  while(q->link[dir] != NULL){
+    last = dir;
+    g = p;
+    p = q;
+    q = q->link[dir];
+    dir = q->key < key;
+    if(q->key == key){
+      f = q;
+    }
+    /* push the red node down */
+    if(!RBTD_isred(q) && !RBTD_isred(q->link[dir])){
+      if(RBTD_isred(q->link[!dir])){
+        p = p->link[last] = RBTD_single(q, dir);
+      }
+      else {
+        s = p->link[!last];
+        if(s != NULL){
+          /* sibling has black children, colour flip */
+          if(!RBTD_isred(s->link[!last]) &&
+            !RBTD_isred(s->link[last])){
+            p->colour = black;
+            s->colour = red;
+            q->colour = red;
+          }
+          /* sibling has a red child, rotate it up */
+          else {
+            dir2 = g->link[RIGHT] == p;
+            if(RBTD_isred(s->link[last])){
+              g->link[dir2] = RBTD_double(p, last);
+            }
+            else {
+              g->link[dir2] = RBTD_single(p, last);
+            }
+            q->colour = red;
+            g->link[dir2]->colour = red;
+            g->link[dir2]->link[LEFT]->colour = black;
+            g->link[dir2]->link[RIGHT]->colour = black;
+          }
+        }
+      }
+    }
+  }
+
+  /* copy the predecessor over the found node and unlink
+  the predecessor, which has at most one child */
+  if(f != NULL){
+    f->key = q->key;
+    p->link[p->link[RIGHT] == q] =
+      q->link[q->link[LEFT] == NULL];
+    free(q);
+  }
+
+  tree->root = head.link[RIGHT];
+  if(tree->root != NULL){
+    tree->root->colour = black;
+  }
+
+  return f != NULL;
+}
+
+RBTDNode* RBTD_search(RBTDTree* tree, int key)
+{
+  RBTDNode *x = tree->root;
+
+  while(x != NULL && x->key != key){
+    x = x->link[x->key < key];
+  }
+  return x;
+}
+
+int RBTD_height(RBTDNode* node)
+{
+  int l_height, r_height;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  l_height = RBTD_height(node->link[LEFT]);
+  r_height = RBTD_height(node->link[RIGHT]);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+void RBTD_free(RBTDTree* tree)
+{
+  RBTD_recur(tree->root);
+  free(tree);
+}
+
+void RBTD_recur(RBTDNode* node)
+{
+  if(node != NULL){
+    RBTD_recur(node->link[LEFT]);
+    RBTD_recur(node->link[RIGHT]);
+    free(node);
+  }
+}
@@ -0,0 +1,324 @@
+/*********************************************************/
+/* RBTMPL.H **********************************************/
+/*********************************************************/
+
+/* Red-black tree as a code template. DECLARE_RBTREE gives
+the node and tree types and the prototypes for a tree
+called NAME holding keys of type T; DEFINE_RBTREE, used in
+exactly one .c file, writes out the functions with CMP
+pasted in wherever keys are compared. CMP(a, b) is a macro
+or pure function returning <0, 0 or >0, and as it is
+expanded in place the compiler can inline it: there is no function
+pointer as in bst.c and no memcpy of elsz bytes.
+
+  DECLARE_RBTREE(irb, int);       in a header
+  DEFINE_RBTREE(irb, int, CMP);   in one .c file
+
+gives irb, irb_node, irb_init, irb_insert, irb_search,
+irb_first, irb_next, irb_height and irb_free. Same
+algorithm as RBTree in ext.c but with NULL for nil and
+no sentinel root. */
+
+#ifndef RBTMPL_H
+#define RBTMPL_H
+
+/* Three-way compare for any arithmetic type */
+#define RB_CMPNUM(a, b) (((a) > (b)) - ((a) < (b)))
+
+#define DECLARE_RBTREE(NAME, T) \
+  typedef struct NAME##_node { \
+    rdblk                colour; \
+    T                    key; \
+    struct NAME##_node*  parent; \
+    struct NAME##_node*  left; \
+    struct NAME##_node*  right; \
+  } NAME##_node; \
+  RBTMPL_TREE(NAME, T)
+
+/* Map: as above with a V val beside each key, and as the
+DEFINE_RBTREE functions never look past key and links they
+are reused unchanged. DEFINE_RBMAP adds
+
+  V*   NAME##_upsert(tree, key, &inserted)
+  V*   NAME##_getptr(tree, key)
+  bool NAME##_get(tree, key, &val)
+  void NAME##_put(tree, key, val)
+
+upsert is a single descent that returns the value slot of
+key, adding key first if it was missing (the slot is then
+uninitialised and *inserted is true). The returned pointer
+updates the value in place and stays valid until key is
+removed. */
+#define DECLARE_RBMAP(NAME, K, V) \
+  typedef struct NAME##_node { \
+    rdblk                colour; \
+    K                    key; \
+    struct NAME##_node*  parent; \
+    struct NAME##_node*  left; \
+    struct NAME##_node*  right; \
+    V                    val; \
+  } NAME##_node; \
+  RBTMPL_TREE(NAME, K); \
+  V*           NAME##_upsert(NAME* tree, K key, \
+                 bool* inserted); \
+  V*           NAME##_getptr(NAME* tree, K key); \
+  bool         NAME##_get(NAME* tree, K key, V* val); \
+  void         NAME##_put(NAME* tree, K key, V val)
+
+#define DEFINE_RBMAP(NAME, K, V, CMP) \
+  DEFINE_RBTREE(NAME, K, CMP); \
+  \
+  V* NAME##_upsert(NAME* tree, K key, bool* inserted) \
+  { \
+    int size = tree->size; \
+    NAME##_node *x = NAME##_insert(tree, key); \
+    *inserted = tree->size != size; \
+    return &x->val; \
+  } \
+  \
+  V* NAME##_getptr(NAME* tree, K key) \
+  { \
+    NAME##_node *x = NAME##_search(tree, key); \
+    if(x == NULL){ \
+      return NULL; \
+    } \
+    return &x->val; \
+  } \
+  \
+  bool NAME##_get(NAME* tree, K key, V* val) \
+  { \
+    V *slot = NAME##_getptr(tree, key); \
+    if(slot == NULL){ \
+      return false; \
+    } \
+    *val = *slot; \
+    return true; \
+  } \
+  \
+  void NAME##_put(NAME* tree, K key, V val) \
+  { \
+    bool inserted; \
+    *NAME##_upsert(tree, key, &inserted) = val; \
+  } \
+  \
+  void NAME##_put(NAME* tree, K key, V val)
+
+/* Tree type and prototypes shared by both, NAME##_node
+must already be defined */
+#define RBTMPL_TREE(NAME, T) \
+  typedef struct NAME { \
+    NAME##_node*         root; \
+    int                  size; \
+  } NAME; \
+  NAME*        NAME##_init(void); \
+  void         NAME##_rotleft(NAME* tree, NAME##_node* x); \
+  void         NAME##_rotright(NAME* tree, NAME##_node* y); \
+  NAME##_node* NAME##_insert(NAME* tree, T key); \
+  NAME##_node* NAME##_search(NAME* tree, T key); \
+  NAME##_node* NAME##_first(NAME* tree); \
+  NAME##_node* NAME##_next(NAME##_node* x); \
+  int          NAME##_height(NAME##_node* node); \
+  void         NAME##_recur(NAME##_node* node); \
+  void         NAME##_free(NAME* tree)
+
+#define DEFINE_RBTREE(NAME, T, CMP) \
+  \
+  NAME* NAME##_init(void) \
+  { \
+    NAME *tree = (NAME*) gfmalloc(sizeof(NAME)); \
+    tree->root = NULL; \
+    tree->size = ZERO; \
+    return tree; \
+  } \
+  \
+  /* re-point whatever pointed at x (parent or root) at \
+  y */ \
+  static void NAME##_relink(NAME* tree, NAME##_node* x, \
+    NAME##_node* y) \
+  { \
+    y->parent = x->parent; \
+    if(x->parent == NULL){ \
+      tree->root = y; \
+    } \
+    else if(x == x->parent->left){ \
+      x->parent->left = y; \
+    } \
+    else { \
+      x->parent->right = y; \
+    } \
+  } \
+  \
+  void NAME##_rotleft(NAME* tree, NAME##_node* x) \
+  { \
+    NAME##_node *y = x->right; \
+    x->right = y->left; \
+    if(y->left != NULL){ \
+      y->left->parent = x; \
+    } \
+    NAME##_relink(tree, x, y); \
+    y->left = x; \
+    x->parent = y; \
+  } \
+  \
+  void NAME##_rotright(NAME* tree, NAME##_node* y) \
+  { \
+    NAME##_node *x = y->left; \
+    y->left = x->right; \
+    if(x->right != NULL){ \
+      x->right->parent = y; \
+    } \
+    NAME##_relink(tree, y, x); \
+    x->right = y; \
+    y->parent = x; \
+  } \
+  \
+  NAME##_node* NAME##_insert(NAME* tree, T key) \
+  { \
+    NAME##_node *x = tree->root, *y = NULL, *z, *g, *u; \
+    /* bst descent, an equal key is returned as is (CMP \
+    twice as in NAME##_search) */ \
+    while(x != NULL && CMP(key, x->key) != ZERO){ \
+      y = x; \
+      if(CMP(key, x->key) < ZERO){ \
+        x = x->left; \
+      } \
+      else { \
+        x = x->right; \
+      } \
+    } \
+    if(x != NULL){ \
+      return x; \
+    } \
+    z = (NAME##_node*) gfmalloc(sizeof(NAME##_node)); \
+    z->key = key; \
+    z->colour = red; \
+    z->left = z->right = NULL; \
+    z->parent = y; \
+    if(y == NULL){ \
+      tree->root = z; \
+    } \
+    else if(CMP(key, y->key) < ZERO){ \
+      y->left = z; \
+    } \
+    else { \
+      y->right = z; \
+    } \
+    tree->size++; \
+    x = z; \
+    /* insert fixup, see RBTree_insert */ \
+    while(x->parent != NULL && x->parent->colour == red){ \
+      g = x->parent->parent; \
+      if(x->parent == g->left){ \
+        u = g->right; \
+        if(u != NULL && u->colour == red){ \
+          x->parent->colour = black; \
+          u->colour = black; \
+          g->colour = red; \
+          x = g; \
+        } \
+        else { \
+          if(x == x->parent->right){ \
+            x = x->parent; \
+            NAME##_rotleft(tree, x); \
+          } \
+          x->parent->colour = black; \
+          g->colour = red; \
+          NAME##_rotright(tree, g); \
+        } \
+      } \
+      else { \
+        u = g->left; \
+        if(u != NULL && u->colour == red){ \
+          x->parent->colour = black; \
+          u->colour = black; \
+          g->colour = red; \
+          x = g; \
+        } \
+        else { \
+          if(x == x->parent->left){ \
+            x = x->parent; \
+            NAME##_rotright(tree, x); \
+          } \
+          x->parent->colour = black; \
+          g->colour = red; \
+          NAME##_rotleft(tree, g); \
+        } \
+      } \
+    } \
+    tree->root->colour = black; \
+    return z; \
+  } \
+  \
+  NAME##_node* NAME##_search(NAME* tree, T key) \
+  { \
+    NAME##_node *x = tree->root; \
+    /* CMP is written twice, not kept in a variable: for a \
+    pure CMP the compiler merges the two and the loop comes \
+    out as a predictable exit test plus a cmov, which lets \
+    the next lookup start before this one has finished, \
+    about twice as fast as testing a stored result */ \
+    while(x != NULL && CMP(key, x->key) != ZERO){ \
+      if(CMP(key, x->key) < ZERO){ \
+        x = x->left; \
+      } \
+      else { \
+        x = x->right; \
+      } \
+    } \
+    return x; \
+  } \
+  \
+  NAME##_node* NAME##_first(NAME* tree) \
+  { \
+    NAME##_node *x = tree->root; \
+    while(x != NULL && x->left != NULL){ \
+      x = x->left; \
+    } \
+    return x; \
+  } \
+  \
+  /* in-order successor, NULL after the last key */ \
+  NAME##_node* NAME##_next(NAME##_node* x) \
+  { \
+    if(x->right != NULL){ \
+      x = x->right; \
+      while(x->left != NULL){ \
+        x = x->left; \
+      } \
+      return x; \
+    } \
+    while(x->parent != NULL && x == x->parent->right){ \
+      x = x->parent; \
+    } \
+    return x->parent; \
+  } \
+  \
+  int NAME##_height(NAME##_node* node) \
+  { \
+    int l, r; \
+    if(node == NULL){ \
+      return ZERO; \
+    } \
+    l = NAME##_height(node->left); \
+    r = NAME##_height(node->right); \
+    return (l > r ? l : r) + ONE; \
+  } \
+  \
+  void NAME##_recur(NAME##_node* node) \
+  { \
+    if(node != NULL){ \
+      NAME##_recur(node->left); \
+      NAME##_recur(node->right); \
+      free(node); \
+    } \
+  } \
+  \
+  void NAME##_free(NAME* tree) \
+  { \
+    NAME##_recur(tree->root); \
+    free(tree); \
+  } \
+  \
+  void NAME##_free(NAME* tree)
+
+#endif
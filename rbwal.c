@@ -0,0 +1,292 @@
+/*********************************************************/
+/* RBWAL.C ***********************************************/
+/*********************************************************/
+
+/* RBTree made durable by a write-ahead log. Every insert
+or delete that changes the tree appends a WAL_RECORD byte
+record (the op and the key, little-endian) to a buffer;
+the buffer is written and fsync'd once batch records have
+built up, so the cost of an fsync is shared by the whole
+batch (group commit). A change is durable once
+RBWal_commit has returned after it: a crash loses at most
+the last batch - 1 changes, never part of one, as replay
+stops at the first record that is not whole.
+
+RBWal_open loads the snapshot, path with WAL_SNAP added,
+and replays the log over it. When the log has grown to
+WAL_COMPACT times the keys held, RBWal_compact writes the
+tree out in order as a new snapshot (to a temporary file
+renamed over the old, so a crash leaves one or the other)
+and empties the log. A crash between the rename and the
+truncate replays the log over a snapshot that already
+holds it, which is harmless: the last record for a key
+decides whether it is there either way. */
+
+/* open, write, fsync and ftruncate are not ANSI */
+#define _GNU_SOURCE
+#include "ext.h"
+#include <unistd.h>
+#include <fcntl.h>
+
+/* batch records per group commit, 1 commits every change */
+RBWal* RBWal_open(const char* path, int batch)
+{
+  RBWal *w;
+
+  if(batch <= ZERO){
+    ON_ERROR("Batch to RBWal_open is <= 0\n");
+  }
+  w = (RBWal*) gfmalloc(sizeof(RBWal));
+  w->tree = RBTree_init();
+  w->size = ZERO;
+  w->batch = batch;
+  w->used = w->pending = ZERO;
+  w->records = w->syncs = ZERO;
+  w->buf = (unsigned char*) gfmalloc(WAL_BUF);
+  w->path = (char*) gfmalloc(strlen(path) + ONE);
+  strcpy(w->path, path);
+  w->snap = (char*) gfmalloc(strlen(path) +
+    strlen(WAL_SNAP) + ONE);
+  sprintf(w->snap, "%s%s", path, WAL_SNAP);
+
+  RBWal_load(w);
+  w->fd = open(path, O_RDWR | O_CREAT, WAL_MODE);
+  if(w->fd < ZERO){
+    ON_ERROR("RBWal_open could not open the log\n");
+  }
+  RBWal_replay(w);
+
+  return w;
+}
+
+/* The snapshot's keys, in order, if there is one */
+void RBWal_load(RBWal* w)
+{
+  FILE *fp;
+  RBFinger f;
+  unsigned char rec[FOUR];
+
+  fp = fopen(w->snap, "rb");
+  if(fp == NULL){
+    return;
+  }
+  RBFinger_init(w->tree, &f);
+  while(fread(rec, ONE, FOUR, fp) == FOUR){
+    RBTree_insertfinger(w->tree, &f, RBWal_getkey(rec));
+    w->size++;
+  }
+  fclose(fp);
+}
+
+/* Apply the log to the tree and leave fd at its end; a
+torn record at the end, from a crash during a write, is
+cut off so new records follow the last whole one */
+void RBWal_replay(RBWal* w)
+{
+  unsigned char *p;
+  long good = ZERO;
+  int n, i, left = ZERO;
+
+  while((n = (int) read(w->fd, w->buf + left,
+    (size_t) (WAL_BUF - left))) > ZERO){
+    n += left;
+    for(i = ZERO; i + WAL_RECORD <= n; i += WAL_RECORD){
+      p = w->buf + i;
+      if(p[ZERO] == WAL_INSERT){
+        RBWal_apply(w, true, RBWal_getkey(p + ONE));
+      }
+      else if(p[ZERO] == WAL_DELETE){
+        RBWal_apply(w, false, RBWal_getkey(p + ONE));
+      }
+      else {
+        break;
+      }
+      good += WAL_RECORD;
+      w->records++;
+    }
+    if(i + WAL_RECORD <= n){
+      break;
+    }
+    left = n - i;
+    memmove(w->buf, w->buf + i, (size_t) left);
+  }
+  if(ftruncate(w->fd, (off_t) good) != ZERO ||
+    lseek(w->fd, (off_t) good, SEEK_SET) < ZERO){
+    ON_ERROR("RBWal_replay could not cut the log\n");
+  }
+}
+
+/* Insert or delete key in the tree alone, true if that
+changed it */
+bool RBWal_apply(RBWal* w, bool insert, int key)
+{
+  RBNode *z;
+
+  if(!insert){
+    if(RBTree_delete(w->tree, key)){
+      w->size--;
+      return true;
+    }
+    return false;
+  }
+  z = (RBNode*) gfmalloc(sizeof(RBNode));
+  z->key = key;
+  if(RBTree_insertnode(w->tree, z) != z){
+    free(z);
+    return false;
+  }
+  w->size++;
+  return true;
+}
+
+bool RBWal_insert(RBWal* w, int key)
+{
+  if(!RBWal_apply(w, true, key)){
+    return false;
+  }
+  RBWal_append(w, WAL_INSERT, key);
+  return true;
+}
+
+bool RBWal_delete(RBWal* w, int key)
+{
+  if(!RBWal_apply(w, false, key)){
+    return false;
+  }
+  RBWal_append(w, WAL_DELETE, key);
+  return true;
+}
+
+bool RBWal_search(RBWal* w, int key)
+{
+  return RBTree_search(w->tree, key) != w->tree->nil;
+}
+
+void RBWal_append(RBWal* w, unsigned char op, int key)
+{
+  if(w->used + WAL_RECORD > WAL_BUF){
+    RBWal_write(w);
+  }
+  w->buf[w->used] = op;
+  RBWal_putkey(w->buf + w->used + ONE, key);
+  w->used += WAL_RECORD;
+  w->records++;
+  if(++w->pending >= w->batch){
+    RBWal_commit(w);
+    if(w->records > WAL_COMPACT * (w->size + WAL_MINLOG)){
+      RBWal_compact(w);
+    }
+  }
+}
+
+/* Buffered records to the file, not yet synced */
+void RBWal_write(RBWal* w)
+{
+  if(w->used > ZERO && write(w->fd, w->buf, (size_t) w->used)
+    != (ssize_t) w->used){
+    ON_ERROR("RBWal_write could not write the log\n");
+  }
+  w->used = ZERO;
+}
+
+/* Every change so far made durable */
+void RBWal_commit(RBWal* w)
+{
+  if(w->pending == ZERO && w->used == ZERO){
+    return;
+  }
+  RBWal_write(w);
+  if(fsync(w->fd) != ZERO){
+    ON_ERROR("RBWal_commit could not sync the log\n");
+  }
+  w->pending = ZERO;
+  w->syncs++;
+}
+
+/* The tree as a new snapshot and the log emptied */
+void RBWal_compact(RBWal* w)
+{
+  FILE *fp;
+  RBNode *x;
+  unsigned char rec[FOUR];
+  char *tmp;
+
+  RBWal_commit(w);
+  tmp = (char*) gfmalloc(strlen(w->snap) + strlen(WAL_TMP) +
+    ONE);
+  sprintf(tmp, "%s%s", w->snap, WAL_TMP);
+  fp = fopen(tmp, "wb");
+  if(fp == NULL){
+    ON_ERROR("RBWal_compact could not open the snapshot\n");
+  }
+  x = RBTree_minimum(w->tree, w->tree->root->left);
+  while(x != w->tree->nil){
+    RBWal_putkey(rec, x->key);
+    fwrite(rec, ONE, FOUR, fp);
+    x = RBTree_next(w->tree, x);
+  }
+  if(fflush(fp) != ZERO || fsync(fileno(fp)) != ZERO){
+    ON_ERROR("RBWal_compact could not write the snapshot\n");
+  }
+  fclose(fp);
+  if(rename(tmp, w->snap) != ZERO){
+    ON_ERROR("RBWal_compact could not rename the snapshot\n");
+  }
+  free(tmp);
+
+  if(ftruncate(w->fd, ZERO) != ZERO ||
+    lseek(w->fd, ZERO, SEEK_SET) < ZERO ||
+    fsync(w->fd) != ZERO){
+    ON_ERROR("RBWal_compact could not empty the log\n");
+  }
+  w->records = ZERO;
+  w->syncs++;
+}
+
+/* Commits what is pending; the files stay for the next
+RBWal_open */
+void RBWal_close(RBWal* w)
+{
+  RBWal_commit(w);
+  close(w->fd);
+  RBTree_free(w->tree);
+  free(w->buf);
+  free(w->path);
+  free(w->snap);
+  free(w);
+}
+
+/* Log and snapshot both gone */
+void RBWal_remove(const char* path)
+{
+  char *snap;
+
+  snap = (char*) gfmalloc(strlen(path) + strlen(WAL_SNAP) +
+    ONE);
+  sprintf(snap, "%s%s", path, WAL_SNAP);
+  remove(path);
+  remove(snap);
+  free(snap);
+}
+
+void RBWal_putkey(unsigned char* p, int key)
+{
+  unsigned int k = (unsigned int) key;
+  int i;
+
+  for(i = ZERO; i < FOUR; i++){
+    p[i] = (unsigned char) (k & UCHAR_MAX);
+    k >>= CHAR_BIT;
+  }
+}
+
+int RBWal_getkey(unsigned char* p)
+{
+  unsigned int k = ZERO;
+  int i;
+
+  for(i = FOUR - ONE; i >= ZERO; i--){
+    k = k << CHAR_BIT | p[i];
+  }
+  return (int) k;
+}
@@ -0,0 +1,191 @@
+/*********************************************************/
+/* SGTREE.C **********************************************/
+/*********************************************************/
+
+/* Scapegoat tree with alpha = 2/3. Nodes carry nothing but
+key and links: when an insert lands deeper than
+log_{3/2}(n) the walk back up finds an ancestor whose child
+holds more than 2/3 of its subtree (the scapegoat) and that
+subtree alone is rebuilt perfectly balanced. */
+
+#include "ext.h"
+
+SGTree* SG_init(void)
+{
+  SGTree *tree;
+
+  tree = (SGTree*) gfmalloc(sizeof(SGTree));
+  tree->root = NULL;
+  tree->size = ZERO;
+
+  return tree;
+}
+
+/* Deepest a node may sit in an alpha-balanced tree of n */
+int SG_halpha(int n)
+{
+  return (int) floor(log((double) n) /
+    log((double) SG_ALPHA_DEN / SG_ALPHA_NUM));
+}
+
+int SGNode_size(SGNode* node)
+{
+  if(node == NULL){
+    return ZERO;
+  }
+  return SGNode_size(node->left) + SGNode_size(node->right)
+    + ONE;
+}
+
+/* In-order copy of the subtree's node pointers into v */
+void SGNode_flatten(SGNode* node, SGNode** v, int* i)
+{
+  if(node != NULL){
+    SGNode_flatten(node->left, v, i);
+    v[(*i)++] = node;
+    SGNode_flatten(node->right, v, i);
+  }
+}
+
+/* Relink v[start..end] as a perfectly balanced tree */
+SGNode* SGNode_build(SGNode** v, int start, int end)
+{
+  int mid;
+
+  if(start > end){
+    return NULL;
+  }
+  mid = (start + end) / TWO;
+  v[mid]->left = SGNode_build(v, start, mid - ONE);
+  v[mid]->right = SGNode_build(v, mid + ONE, end);
+
+  return v[mid];
+}
+
+SGNode* SGNode_rebuild(SGNode* node, int size)
+{
+  SGNode **v;
+  int i = ZERO;
+
+  v = (SGNode**) gfmalloc((size_t) size * sizeof(SGNode*));
+  SGNode_flatten(node, v, &i);
+  node = SGNode_build(v, ZERO, size - ONE);
+  free(v);
+
+  return node;
+}
+
+void SG_insert(SGTree* tree, int key)
+{
+  SGNode *path[SG_MAXDEPTH], **link, *node, *child, *w;
+  SGNode *sibling;
+  int depth = ZERO, i, childsize, wsize;
+
+  /* descend remembering the path, there are no parent
+  pointers */
+  link = &tree->root;
+  while(*link != NULL){
+    if(depth == SG_MAXDEPTH){
+      ON_ERROR("SG_insert path too deep\n");
+    }
+    path[depth++] = *link;
+    if(key < (*link)->key){
+      link = &(*link)->left;
+    }
+    else if(key > (*link)->key){
+      link = &(*link)->right;
+    }
+    else {
+      return;
+    }
+  }
+  node = (SGNode*) gfmalloc(sizeof(SGNode));
+  node->key = key;
+  node->left = node->right = NULL;
+  *link = node;
+  tree->size++;
+
+  if(depth <= SG_halpha(tree->size)){
+    return;
+  }
+
+  /* too deep, sizes are counted on the way back up, only
+  the sibling subtrees are walked */
+  child = node;
+  childsize = ONE;
+  for(i = depth - ONE; i >= ZERO; i--){
+    w = path[i];
+    if(w->left == child){
+      sibling = w->right;
+    }
+    else {
+      sibling = w->left;
+    }
+    wsize = childsize + SGNode_size(sibling) + ONE;
+    if(SG_ALPHA_DEN * childsize > SG_ALPHA_NUM * wsize){
+      w = SGNode_rebuild(w, wsize);
+      if(i == ZERO){
+        tree->root = w;
+      }
+      else if(path[i - ONE]->left == path[i]){
+        path[i - ONE]->left = w;
+      }
+      else {
+        path[i - ONE]->right = w;
+      }
+      return;
+    }
+    child = w;
+    childsize = wsize;
+  }
+}
+
+bool SG_search(SGTree* tree, int key)
+{
+  SGNode *x = tree->root;
+
+  while(x != NULL && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x != NULL;
+}
+
+int SGNode_height(SGNode* node)
+{
+  int l_height, r_height;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  l_height = SGNode_height(node->left);
+  r_height = SGNode_height(node->right);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+int SG_height(SGTree* tree)
+{
+  return SGNode_height(tree->root);
+}
+
+void SG_free(SGTree* tree)
+{
+  SG_recur(tree->root);
+  free(tree);
+}
+
+void SG_recur(SGNode* node)
+{
+  if(node != NULL){
+    SG_recur(node->left);
+    SG_recur(node->right);
+    free(node);
+  }
+}
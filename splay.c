@@ -0,0 +1,179 @@
+/*********************************************************/
+/* SPLAY.C ***********************************************/
+/*********************************************************/
+
+/* Splay tree (top-down splay as in Sleator & Tarjan). Every
+access moves its key to the root, so recently and often
+used keys stay near the top: no balance information is
+stored but the tree can degenerate into a path, e.g. after
+sorted inserts, so height and free are iterative here. */
+
+#include "ext.h"
+
+SplayTree* Splay_init(void)
+{
+  SplayTree *tree;
+
+  tree = (SplayTree*) gfmalloc(sizeof(SplayTree));
+  tree->root = NULL;
+  tree->size = ZERO;
+
+  return tree;
+}
+
+/* Split the tree into a left tree (keys < key) and a
+right tree (keys > key) while walking down, rotating on
+zig-zig steps, then reassemble them under the last node
+reached */
+SplayNode* SplayNode_splay(SplayNode* t, int key)
+{
+  SplayNode head, *l, *r, *y;
+
+  if(t == NULL){
+    return t;
+  }
+  head.left = head.right = NULL;
+  l = r = &head;
+
+  for(;;){
+    if(key < t->key){
+      if(t->left == NULL){
+        break;
+      }
+      if(key < t->left->key){
+        y = t->left;
+        t->left = y->right;
+        y->right = t;
+        t = y;
+        if(t->left == NULL){
+          break;
+        }
+      }
+      /* link t into the right tree */
+      r->left = t;
+      r = t;
+      t = t->left;
+    }
+    else if(key > t->key){
+      if(t->right == NULL){
+        break;
+      }
+      if(key > t->right->key){
+        y = t->right;
+        t->right = y->left;
+        y->left = t;
+        t = y;
+        if(t->right == NULL){
+          break;
+        }
+      }
+      /* link t into the left tree */
+      l->right = t;
+      l = t;
+      t = t->right;
+    }
+    else {
+      break;
+    }
+  }
+  l->right = t->left;
+  r->left = t->right;
+  t->left = head.right;
+  t->right = head.left;
+
+  return t;
+}
+
+void Splay_insert(SplayTree* tree, int key)
+{
+  SplayNode *node, *root;
+
+  if(tree->root != NULL){
+    tree->root = SplayNode_splay(tree->root, key);
+    if(tree->root->key == key){
+      return;
+    }
+  }
+  node = (SplayNode*) gfmalloc(sizeof(SplayNode));
+  node->key = key;
+  node->left = node->right = NULL;
+  root = tree->root;
+
+  /* new node becomes the root, with the splayed tree split
+  either side of it */
+  if(root != NULL){
+    if(key < root->key){
+      node->left = root->left;
+      node->right = root;
+      root->left = NULL;
+    }
+    else {
+      node->right = root->right;
+      node->left = root;
+      root->right = NULL;
+    }
+  }
+  tree->root = node;
+  tree->size++;
+}
+
+bool Splay_search(SplayTree* tree, int key)
+{
+  if(tree->root == NULL){
+    return false;
+  }
+  tree->root = SplayNode_splay(tree->root, key);
+  return tree->root->key == key;
+}
+
+/* Level by level with a queue of at most size nodes */
+int Splay_height(SplayTree* tree)
+{
+  SplayNode **queue, *x;
+  int head = ZERO, tail = ZERO, levelend, height = ZERO;
+
+  if(tree->root == NULL){
+    return ZERO;
+  }
+  queue = (SplayNode**) gfmalloc((size_t) tree->size *
+    sizeof(SplayNode*));
+  queue[tail++] = tree->root;
+  while(head < tail){
+    levelend = tail;
+    while(head < levelend){
+      x = queue[head++];
+      if(x->left != NULL){
+        queue[tail++] = x->left;
+      }
+      if(x->right != NULL){
+        queue[tail++] = x->right;
+      }
+    }
+    height++;
+  }
+  free(queue);
+
+  return height;
+}
+
+/* Rotate left children up until the root has none, then
+free it and carry on down the right spine */
+void Splay_free(SplayTree* tree)
+{
+  SplayNode *x = tree->root, *y;
+
+  while(x != NULL){
+    if(x->left != NULL){
+      y = x->left;
+      x->left = y->right;
+      y->right = x;
+      x = y;
+    }
+    else {
+      y = x->right;
+      free(x);
+      x = y;
+    }
+  }
+  free(tree);
+}
@@ -0,0 +1,160 @@
+/*********************************************************/
+/* STRESS.C **********************************************/
+/*********************************************************/
+
+/* ./ext stress [ops] [seed] runs ops random inserts,
+deletes and lookups over a small key range against every
+tree that can delete (RBTree, RBTree with its hash index,
+the top-down RB tree and WAVL) and against a sorted array
+that is taken to be right. Any answer that differs stops
+the run; every STRESS_CHECK ops, and at the end, the RB
+trees go through RBTree_validate and all four are compared
+key for key with the array. The seed is printed so that a
+failing run can be repeated. */
+
+#include "ext.h"
+
+int stress_run(int argc, char* argv[])
+{
+  RBTree *tree, *htree;
+  RBHash *h;
+  RBTDTree *td;
+  WAVLTree *wavl;
+  int *oracle, n = ZERO, ops = STRESS_OPS, i, op, key, pos;
+  unsigned seed = (unsigned) time(NULL);
+  bool in, ok = true;
+
+  if(argc > ZERO){
+    ops = atoi(argv[ZERO]);
+  }
+  if(argc > ONE){
+    seed = (unsigned) atol(argv[ONE]);
+  }
+  if(ops <= ZERO){
+    ON_ERROR("Ops to stress_run is <= 0\n");
+  }
+  printf("\n  stress: %d ops over %d keys, seed %u\n", ops,
+    STRESS_KEYS, seed);
+  srand(seed);
+
+  oracle = (int*) gfmalloc(STRESS_KEYS * sizeof(int));
+  tree = RBTree_init();
+  htree = RBTree_init();
+  h = RBHash_init(htree, ZERO);
+  td = RBTD_init();
+  wavl = WAVL_init();
+
+  for(i = ZERO; i < ops && ok; i++){
+    op = rand() % THREE;
+    key = rand() % STRESS_KEYS;
+    pos = stress_find(oracle, n, key);
+    in = pos < n && oracle[pos] == key;
+
+    if(op == ZERO){
+      ok = (RBTree_search(tree, key) != tree->nil) == in &&
+        RBTD_insert(td, key) == !in;
+      RBTree_insert(tree, key);
+      RBHash_insert(h, key);
+      WAVL_insert(wavl, key);
+      if(!in){
+        memmove(oracle + pos + ONE, oracle + pos,
+          (size_t) (n - pos) * sizeof(int));
+        oracle[pos] = key;
+        n++;
+      }
+    }
+    else if(op == ONE){
+      ok = RBTree_delete(tree, key) == in &&
+        RBHash_delete(h, key) == in &&
+        RBTD_delete(td, key) == in &&
+        WAVL_delete(wavl, key) == in;
+      if(in){
+        memmove(oracle + pos, oracle + pos + ONE,
+          (size_t) (n - pos - ONE) * sizeof(int));
+        n--;
+      }
+    }
+    else {
+      ok = (RBTree_search(tree, key) != tree->nil) == in &&
+        RBHash_isin(h, key) == in &&
+        (RBTD_search(td, key) != NULL) == in &&
+        WAVL_search(wavl, key) == in;
+    }
+    if(!ok){
+      fprintf(stderr, "  op %d (%s %d) disagrees with the "
+        "array\n", i, op == ZERO ? "insert" : op == ONE ?
+        "delete" : "search", key);
+    }
+    else if((i + ONE) % STRESS_CHECK == ZERO ||
+      i + ONE == ops){
+      ok = stress_check(tree, h, td, wavl, oracle, n);
+      printf("  %d ops, %d keys, %s\n", i + ONE, n,
+        ok ? "ok" : "FAILED");
+    }
+  }
+  if(!ok){
+    fprintf(stderr, "  repeat with ./ext stress %d %u\n", ops,
+      seed);
+  }
+
+  RBHash_free(h);
+  RBTree_free(htree);
+  RBTree_free(tree);
+  RBTD_free(td);
+  WAVL_free(wavl);
+  free(oracle);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* First index of a[0..n-1] (sorted) holding a value >= key */
+int stress_find(int* a, int n, int key)
+{
+  int lo = ZERO, hi = n, mid;
+
+  while(lo < hi){
+    mid = lo + (hi - lo) / TWO;
+    if(a[mid] < key){
+      lo = mid + ONE;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/* Full comparison of every tree with the array */
+bool stress_check(RBTree* tree, RBHash* h, RBTDTree* td,
+  WAVLTree* wavl, int* oracle, int n)
+{
+  RBTree *trees[TWO];
+  RBNode *x;
+  int i, t, key, pos;
+  bool ok = true, in;
+
+  trees[ZERO] = tree;
+  trees[ONE] = h->tree;
+  for(t = ZERO; t < TWO; t++){
+    if(RBTree_validate(trees[t], stderr) != ZERO){
+      ok = false;
+    }
+    /* in order walk must be the array exactly */
+    x = RBTree_minimum(trees[t], trees[t]->root->left);
+    for(i = ZERO; i < n && x != trees[t]->nil; i++){
+      ok = ok && x->key == oracle[i];
+      x = RBTree_next(trees[t], x);
+    }
+    ok = ok && i == n && x == trees[t]->nil;
+  }
+  ok = ok && h->size == n;
+
+  for(key = ZERO; key < STRESS_KEYS; key++){
+    pos = stress_find(oracle, n, key);
+    in = pos < n && oracle[pos] == key;
+    ok = ok && RBHash_isin(h, key) == in &&
+      (RBTD_search(td, key) != NULL) == in &&
+      WAVL_search(wavl, key) == in;
+  }
+  return ok;
+}
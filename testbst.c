@@ -0,0 +1,404 @@
+/*********************************************************/
+/* TESTBST.C *********************************************/
+/*********************************************************/
+
+/* Checks bst.c, the assignment's interface and what was
+added to it, against what the answers must be: sorted
+order, sizes and depths known for the shapes built, and
+the added calls against the plain ones they speed up.
+Stops at the first assert that fails. */
+
+#include "bst.h"
+
+#define ZERO 0
+#define ONE 1
+#define TWO 2
+#define THREE 3
+#define TEST_N 2000
+#define TEST_STR 16
+#define TEST_THREADS 8
+/* stride coprime to TEST_N, i * TEST_STEP % TEST_N is a
+shuffle of 0 .. TEST_N - 1 */
+#define TEST_STEP 7919
+
+/* bst_upsert's items: ordered by key alone */
+struct pair {
+  int     key;
+  int     value;
+};
+typedef struct pair pair;
+
+int       int_compare(const void* a, const void* b);
+char*     int_print(const void* a);
+int       str_compare(const void* a, const void* b);
+char*     str_print(const void* a);
+int       pair_compare(const void* a, const void* b);
+void      test_basic(void);
+void      test_batch(void);
+void      test_map(void);
+void      test_insertsg(void);
+void      test_print(void);
+void      test_validate(void);
+void      test_finger(void);
+void      test_pq(void);
+void      test_par(void);
+
+int main(void)
+{
+  test_basic();
+  test_batch();
+  test_map();
+  test_insertsg();
+  test_print();
+  test_validate();
+  test_finger();
+  test_pq();
+  test_par();
+  printf("testbst: all passed\n");
+
+  return EXIT_SUCCESS;
+}
+
+int int_compare(const void* a, const void* b)
+{
+  const int *x = (const int*) a, *y = (const int*) b;
+
+  return (*x > *y) - (*x < *y);
+}
+
+/* one static buffer, as the printers bst.c is given do */
+char* int_print(const void* a)
+{
+  static char str[TEST_STR];
+
+  sprintf(str, "%d", *(const int*) a);
+  return str;
+}
+
+int str_compare(const void* a, const void* b)
+{
+  return strcmp((const char*) a, (const char*) b);
+}
+
+char* str_print(const void* a)
+{
+  return (char*) a;
+}
+
+int pair_compare(const void* a, const void* b)
+{
+  return int_compare(&((const pair*) a)->key,
+    &((const pair*) b)->key);
+}
+
+/* insert, isin, size, depth, getordered and rebalance on
+string keys in a shuffled order; getordered and rebalance
+copy what prntnode gives, so they are for string trees */
+void test_basic(void)
+{
+  bst *b, *r;
+  char s[TEST_STR], *v;
+  int i;
+
+  b = bst_init(TEST_STR, str_compare, str_print);
+  assert(bst_size(b) == ZERO);
+  assert(bst_maxdepth(b) == ZERO);
+  memset(s, ZERO, TEST_STR);
+  for(i = ZERO; i < TEST_N; i++){
+    sprintf(s, "k%07d", i * TEST_STEP % TEST_N);
+    bst_insert(b, s);
+  }
+  /* again, changes nothing */
+  bst_insert(b, s);
+  assert(bst_size(b) == TEST_N);
+  for(i = ZERO; i < TEST_N; i++){
+    sprintf(s, "k%07d", i);
+    assert(bst_isin(b, s));
+  }
+  sprintf(s, "k%07d", TEST_N);
+  assert(!bst_isin(b, s));
+  assert(!bst_isin(b, "a"));
+
+  r = bst_rebalance(b);
+  assert(bst_size(r) == TEST_N);
+  /* perfectly balanced: 2000 items fill 11 levels */
+  assert(bst_maxdepth(r) == 11);
+  v = (char*) calloc(TEST_N, TEST_STR);
+  assert(v != NULL);
+  bst_getordered(r, v);
+  for(i = ZERO; i < TEST_N; i++){
+    sprintf(s, "k%07d", i);
+    assert(strcmp(v + i * TEST_STR, s) == ZERO);
+  }
+  free(v);
+  bst_free(&b);
+  bst_free(&r);
+  assert(b == NULL);
+}
+
+/* bst_isinbatch against bst_isin, half the keys there */
+void test_batch(void)
+{
+  bst *b;
+  int keys[TEST_N * TWO], i, k;
+  bool out[TEST_N * TWO];
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  for(i = ZERO; i < TEST_N; i++){
+    k = i * TEST_STEP % TEST_N * TWO;
+    bst_insert(b, &k);
+  }
+  for(i = ZERO; i < TEST_N * TWO; i++){
+    keys[i] = i * TEST_STEP % (TEST_N * TWO);
+  }
+  bst_isinbatch(b, keys, TEST_N * TWO, out);
+  for(i = ZERO; i < TEST_N * TWO; i++){
+    assert(out[i] == (keys[i] % TWO == ZERO));
+    assert(out[i] == bst_isin(b, &keys[i]));
+  }
+  bst_free(&b);
+}
+
+/* upsert, get and put with the tree as a map */
+void test_map(void)
+{
+  bst *b;
+  pair p, *q;
+  bool inserted;
+  int i;
+
+  b = bst_init(sizeof(pair), pair_compare, NULL);
+  for(i = ZERO; i < TEST_N; i++){
+    p.key = i * TEST_STEP % TEST_N;
+    p.value = p.key * TWO;
+    q = (pair*) bst_upsert(b, &p, &inserted);
+    assert(inserted && q->key == p.key &&
+      q->value == p.value);
+  }
+  p.key = ONE;
+  p.value = -ONE;
+  q = (pair*) bst_upsert(b, &p, &inserted);
+  assert(!inserted && q->value == TWO);
+  bst_put(b, &p);
+  q = (pair*) bst_get(b, &p);
+  assert(q != NULL && q->value == -ONE);
+  p.key = TEST_N;
+  assert(bst_get(b, &p) == NULL);
+  bst_put(b, &p);
+  assert(bst_size(b) == TEST_N + ONE);
+  q = (pair*) bst_get(b, &p);
+  assert(q != NULL && q->value == -ONE);
+  bst_free(&b);
+}
+
+/* bst_insertsg pulls a chain bst_insert left into shape and
+keeps sorted runs from making new ones */
+void test_insertsg(void)
+{
+  bst *b;
+  int i, n, limit = ZERO;
+  double p = ONE;
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  for(i = ZERO; i < TEST_N; i++){
+    bst_insert(b, &i);
+  }
+  n = bst_size(b);
+  for(i = TEST_N; i < TEST_N * 50; i++){
+    assert(bst_insertsg(b, &i, &n));
+  }
+  for(i = -ONE; i > -TEST_N * 50; i--){
+    assert(bst_insertsg(b, &i, &n));
+  }
+  i = ZERO;
+  assert(!bst_insertsg(b, &i, &n));
+  assert(n == TEST_N * 100 - ONE);
+  assert(bst_size(b) == n);
+  for(i = ONE - TEST_N * 50; i < TEST_N * 50; i++){
+    assert(bst_isin(b, &i));
+  }
+  /* within a level or two of log_{3/2}(n) */
+  while(p * THREE / TWO <= n){
+    p = p * THREE / TWO;
+    limit++;
+  }
+  assert(bst_maxdepth(b) <= limit + TWO);
+  bst_free(&b);
+}
+
+/* bst_fprint writes what bst_print returns */
+void test_print(void)
+{
+  bst *b;
+  FILE *fp;
+  char *str, *file;
+  long len;
+  int i, k;
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  for(i = ZERO; i < 100; i++){
+    k = i * TEST_STEP % 100;
+    bst_insert(b, &k);
+  }
+  str = bst_print(b);
+  fp = tmpfile();
+  assert(fp != NULL);
+  bst_fprint(b, fp);
+  len = ftell(fp);
+  assert(len == (long) strlen(str));
+  file = (char*) calloc((size_t) len + ONE, ONE);
+  assert(file != NULL);
+  rewind(fp);
+  assert(fread(file, ONE, (size_t) len, fp) == (size_t) len);
+  assert(strcmp(str, file) == ZERO);
+  fclose(fp);
+  free(file);
+  free(str);
+  bst_free(&b);
+}
+
+/* bst_validate passes good trees, with the count kept for
+bst_insertsg, and finds a count that is off and a tree put
+out of order */
+void test_validate(void)
+{
+  bst *b;
+  void *swap;
+  int i, k, n = ZERO;
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  assert(bst_validate(b, ZERO, NULL) == ZERO);
+  for(i = ZERO; i < TEST_N; i++){
+    k = i * TEST_STEP % TEST_N;
+    bst_insertsg(b, &k, &n);
+  }
+  for(i = ZERO; i < TEST_N; i++){
+    bst_insertsg(b, &i, &n);
+  }
+  assert(n == TEST_N);
+  assert(bst_validate(b, n, NULL) == ZERO);
+  assert(bst_validate(b, -ONE, NULL) == ZERO);
+  assert(bst_validate(b, n + ONE, NULL) > ZERO);
+
+  swap = b->top->data;
+  b->top->data = b->top->right->data;
+  b->top->right->data = swap;
+  assert(bst_validate(b, n, NULL) > ZERO);
+  bst_free(&b);
+}
+
+/* bst_insertarray goes through a finger, the same tree as
+bst_insert one at a time, whichever way a run goes */
+void test_finger(void)
+{
+  bst *b, *c;
+  bstfinger f = {NULL, NULL, NULL};
+  int a[TEST_N], i, k, last;
+
+  for(i = ZERO; i < TEST_N; i++){
+    a[i] = i;
+  }
+  b = bst_init(sizeof(int), int_compare, int_print);
+  bst_insertarray(b, a, TEST_N);
+  assert(bst_size(b) == TEST_N);
+  /* a sorted run is a chain */
+  assert(bst_maxdepth(b) == TEST_N);
+  assert(bst_validate(b, TEST_N, NULL) == ZERO);
+  bst_free(&b);
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  c = bst_init(sizeof(int), int_compare, int_print);
+  for(i = ZERO; i < TEST_N; i++){
+    /* runs up and down, with jumps between */
+    k = (i / 100) % TWO == ZERO ? i : TEST_N * TWO - i;
+    assert(bst_insertfinger(b, &k, &f));
+    assert(bst_fingerfresh(b, &f));
+    bst_insert(c, &k);
+  }
+  assert(!bst_insertfinger(b, &k, &f));
+  assert(bst_size(b) == bst_size(c));
+  assert(bst_maxdepth(b) == bst_maxdepth(c));
+  assert(bst_validate(b, TEST_N, NULL) == ZERO);
+  /* popping down to the finger's successor stales it */
+  assert(f.succ != NULL);
+  last = *(int*) f.succ->data;
+  do {
+    assert(bst_popmax(b, &k));
+  } while(k != last);
+  assert(!bst_fingerfresh(b, &f));
+  bst_free(&b);
+  bst_free(&c);
+}
+
+/* both ends, in order, until empty */
+void test_pq(void)
+{
+  bst *b;
+  int i, k, last;
+
+  b = bst_init(sizeof(int), int_compare, int_print);
+  assert(bst_peekmin(b) == NULL && !bst_popmin(b, &k));
+  assert(bst_peekmax(b) == NULL && !bst_popmax(b, &k));
+  for(i = ZERO; i < TEST_N; i++){
+    k = i * TEST_STEP % TEST_N;
+    bst_insert(b, &k);
+  }
+  assert(*(int*) bst_peekmin(b) == ZERO);
+  assert(*(int*) bst_peekmax(b) == TEST_N - ONE);
+  last = -ONE;
+  for(i = ZERO; i < TEST_N / TWO; i++){
+    assert(bst_popmin(b, &k) && k == last + ONE);
+    last = k;
+  }
+  last = TEST_N;
+  for(i = TEST_N / TWO; i < TEST_N; i++){
+    assert(bst_popmax(b, &k) && k == last - ONE);
+    last = k;
+  }
+  assert(bst_size(b) == ZERO && !bst_popmin(b, &k));
+  bst_free(&b);
+}
+
+/* the parallel walks against the plain ones, for every
+thread count up to TEST_THREADS */
+void test_par(void)
+{
+  bst *b;
+  char s[TEST_STR], *plain, *par;
+  int i, t;
+
+  b = bst_init(TEST_STR, str_compare, str_print);
+  memset(s, ZERO, TEST_STR);
+  for(i = ZERO; i < TEST_N; i++){
+    sprintf(s, "k%07d", i * TEST_STEP % TEST_N);
+    bst_insert(b, s);
+  }
+  plain = (char*) calloc(TEST_N, TEST_STR);
+  par = (char*) calloc(TEST_N, TEST_STR);
+  assert(plain != NULL && par != NULL);
+  bst_getordered(b, plain);
+  for(t = ONE; t <= TEST_THREADS; t++){
+    assert(bst_sizepar(b, t) == bst_size(b));
+    assert(bst_maxdepthpar(b, t) == bst_maxdepth(b));
+    memset(par, ZERO, (size_t) TEST_N * TEST_STR);
+    bst_getorderedpar(b, par, t);
+    assert(memcmp(plain, par, (size_t) TEST_N * TEST_STR)
+      == ZERO);
+  }
+  bst_free(&b);
+
+  /* a static buffer printer gives the same answer too */
+  b = bst_init(TEST_STR, int_compare, int_print);
+  memset(s, ZERO, TEST_STR);
+  for(i = ZERO; i < TEST_N; i++){
+    *(int*) s = i * TEST_STEP % TEST_N;
+    bst_insert(b, s);
+  }
+  bst_getordered(b, plain);
+  bst_getorderedpar(b, par, TEST_THREADS);
+  assert(memcmp(plain, par, (size_t) TEST_N * TEST_STR)
+    == ZERO);
+  bst_free(&b);
+  free(plain);
+  free(par);
+}
@@ -0,0 +1,120 @@
+/*********************************************************/
+/* TREAP.C ***********************************************/
+/*********************************************************/
+
+/* Treap: a bst on the keys that is also a max-heap on a
+random priority drawn at insert, so its shape is that of a
+random bst whatever order the keys arrive in. */
+
+#include "ext.h"
+
+Treap* Treap_init(void)
+{
+  Treap *tree;
+
+  tree = (Treap*) gfmalloc(sizeof(Treap));
+  tree->root = NULL;
+
+  return tree;
+}
+
+TreapNode* TreapNode_rotleft(TreapNode* x)
+{
+  TreapNode *y = x->right;
+
+  x->right = y->left;
+  y->left = x;
+
+  return y;
+}
+
+TreapNode* TreapNode_rotright(TreapNode* y)
+{
+  TreapNode *x = y->left;
+
+  y->left = x->right;
+  x->right = y;
+
+  return x;
+}
+
+TreapNode* TreapNode_insert(TreapNode* node, int key)
+{
+  if(node == NULL){
+    node = (TreapNode*) gfmalloc(sizeof(TreapNode));
+    node->key = key;
+    node->prio = rand();
+    node->left = node->right = NULL;
+    return node;
+  }
+  /* insert as a leaf then rotate up while the child beats
+  its parent's priority */
+  if(key < node->key){
+    node->left = TreapNode_insert(node->left, key);
+    if(node->left->prio > node->prio){
+      node = TreapNode_rotright(node);
+    }
+  }
+  else if(key > node->key){
+    node->right = TreapNode_insert(node->right, key);
+    if(node->right->prio > node->prio){
+      node = TreapNode_rotleft(node);
+    }
+  }
+  return node;
+}
+
+void Treap_insert(Treap* tree, int key)
+{
+  tree->root = TreapNode_insert(tree->root, key);
+}
+
+bool Treap_search(Treap* tree, int key)
+{
+  TreapNode *x = tree->root;
+
+  while(x != NULL && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x != NULL;
+}
+
+int TreapNode_height(TreapNode* node)
+{
+  int l_height, r_height;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  l_height = TreapNode_height(node->left);
+  r_height = TreapNode_height(node->right);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+int Treap_height(Treap* tree)
+{
+  return TreapNode_height(tree->root);
+}
+
+void Treap_free(Treap* tree)
+{
+  Treap_recur(tree->root);
+  free(tree);
+}
+
+void Treap_recur(TreapNode* node)
+{
+  if(node != NULL){
+    Treap_recur(node->left);
+    Treap_recur(node->right);
+    free(node);
+  }
+}
@@ -0,0 +1,306 @@
+/*********************************************************/
+/* WAVL.C ************************************************/
+/*********************************************************/
+
+/* Weak AVL tree (Haeupler, Sen & Tarjan). Each node has an
+integer rank, a missing child has rank -1 and the rank
+difference to every child must be 1 or 2, with leaves at
+rank 0. Built by inserts alone it is exactly an AVL tree;
+deletes only demote, and need at most two rotations, so
+height stays within 2lg(n) where AVL would rotate all the
+way back up. */
+
+#include "ext.h"
+
+WAVLTree* WAVL_init(void)
+{
+  WAVLTree *tree;
+
+  tree = (WAVLTree*) gfmalloc(sizeof(WAVLTree));
+  tree->root = NULL;
+
+  return tree;
+}
+
+int WAVLNode_rank(WAVLNode* node)
+{
+  if(node == NULL){
+    return -ONE;
+  }
+  return node->rank;
+}
+
+/* After an insert into x->left, x->left may now have the
+same rank as x (a 0-child) */
+WAVLNode* WAVLNode_fixleft(WAVLNode* x)
+{
+  WAVLNode *c = x->left, *t;
+
+  if(c->rank != x->rank){
+    return x;
+  }
+  /* 0,1 node, promote and let the parent check */
+  if(x->rank - WAVLNode_rank(x->right) == ONE){
+    x->rank++;
+    return x;
+  }
+  /* 0,2 node, c's outer child is its 1-child so a single
+  rotation will do */
+  if(c->rank - WAVLNode_rank(c->right) == TWO){
+    x->left = c->right;
+    c->right = x;
+    x->rank--;
+    return c;
+  }
+  /* otherwise c's inner child t comes up to the top */
+  t = c->right;
+  c->right = t->left;
+  x->left = t->right;
+  t->left = c;
+  t->right = x;
+  t->rank++;
+  c->rank--;
+  x->rank--;
+
+  return t;
+}
+
+WAVLNode* WAVLNode_fixright(WAVLNode* x)
+{
+  WAVLNode *c = x->right, *t;
+
+  if(c->rank != x->rank){
+    return x;
+  }
+  if(x->rank - WAVLNode_rank(x->left) == ONE){
+    x->rank++;
+    return x;
+  }
+  if(c->rank - WAVLNode_rank(c->left) == TWO){
+    x->right = c->left;
+    c->left = x;
+    x->rank--;
+    return c;
+  }
+  t = c->left;
+  c->left = t->right;
+  x->right = t->left;
+  t->right = c;
+  t->left = x;
+  t->rank++;
+  c->rank--;
+  x->rank--;
+
+  return t;
+}
+
+WAVLNode* WAVLNode_insert(WAVLNode* x, int key)
+{
+  if(x == NULL){
+    x = (WAVLNode*) gfmalloc(sizeof(WAVLNode));
+    x->key = key;
+    x->rank = ZERO;
+    x->left = x->right = NULL;
+    return x;
+  }
+  if(key < x->key){
+    x->left = WAVLNode_insert(x->left, key);
+    return WAVLNode_fixleft(x);
+  }
+  if(key > x->key){
+    x->right = WAVLNode_insert(x->right, key);
+    return WAVLNode_fixright(x);
+  }
+  return x;
+}
+
+void WAVL_insert(WAVLTree* tree, int key)
+{
+  tree->root = WAVLNode_insert(tree->root, key);
+}
+
+/* After a delete below x, x->left may have become a
+3-child */
+WAVLNode* WAVLNode_delfixleft(WAVLNode* x)
+{
+  WAVLNode *s = x->right, *t;
+
+  if(x->rank - WAVLNode_rank(x->left) != THREE){
+    return x;
+  }
+  /* sibling is a 2-child, demote x and let the parent
+  check */
+  if(x->rank - WAVLNode_rank(s) == TWO){
+    x->rank--;
+    return x;
+  }
+  /* sibling is a 2,2 node, demote both */
+  if(s->rank - WAVLNode_rank(s->left) == TWO &&
+    s->rank - WAVLNode_rank(s->right) == TWO){
+    x->rank--;
+    s->rank--;
+    return x;
+  }
+  /* sibling's outer child is a 1-child, single rotation */
+  if(s->rank - WAVLNode_rank(s->right) == ONE){
+    x->right = s->left;
+    s->left = x;
+    s->rank++;
+    x->rank--;
+    if(x->left == NULL && x->right == NULL){
+      x->rank = ZERO;
+    }
+    return s;
+  }
+  /* double rotation through the inner child */
+  t = s->left;
+  s->left = t->right;
+  x->right = t->left;
+  t->right = s;
+  t->left = x;
+  t->rank += TWO;
+  s->rank--;
+  x->rank -= TWO;
+
+  return t;
+}
+
+WAVLNode* WAVLNode_delfixright(WAVLNode* x)
+{
+  WAVLNode *s = x->left, *t;
+
+  if(x->rank - WAVLNode_rank(x->right) != THREE){
+    return x;
+  }
+  if(x->rank - WAVLNode_rank(s) == TWO){
+    x->rank--;
+    return x;
+  }
+  if(s->rank - WAVLNode_rank(s->right) == TWO &&
+    s->rank - WAVLNode_rank(s->left) == TWO){
+    x->rank--;
+    s->rank--;
+    return x;
+  }
+  if(s->rank - WAVLNode_rank(s->left) == ONE){
+    x->left = s->right;
+    s->right = x;
+    s->rank++;
+    x->rank--;
+    if(x->left == NULL && x->right == NULL){
+      x->rank = ZERO;
+    }
+    return s;
+  }
+  t = s->right;
+  s->right = t->left;
+  x->left = t->right;
+  t->left = s;
+  t->right = x;
+  t->rank += TWO;
+  s->rank--;
+  x->rank -= TWO;
+
+  return t;
+}
+
+WAVLNode* WAVLNode_delete(WAVLNode* x, int key, bool* found)
+{
+  WAVLNode *child, *m;
+
+  if(x == NULL){
+    return NULL;
+  }
+  if(key < x->key){
+    x->left = WAVLNode_delete(x->left, key, found);
+  }
+  else if(key > x->key){
+    x->right = WAVLNode_delete(x->right, key, found);
+  }
+  else {
+    *found = true;
+    /* zero or one child, splice x out */
+    if(x->left == NULL || x->right == NULL){
+      child = x->left;
+      if(child == NULL){
+        child = x->right;
+      }
+      free(x);
+      return child;
+    }
+    /* two children, take the successor's key and delete
+    the successor from the right subtree */
+    m = x->right;
+    while(m->left != NULL){
+      m = m->left;
+    }
+    x->key = m->key;
+    x->right = WAVLNode_delete(x->right, m->key, found);
+  }
+
+  /* a leaf left at rank 1 is a 2,2 leaf, demote it */
+  if(x->left == NULL && x->right == NULL && x->rank == ONE){
+    x->rank = ZERO;
+    return x;
+  }
+  x = WAVLNode_delfixleft(x);
+  return WAVLNode_delfixright(x);
+}
+
+bool WAVL_delete(WAVLTree* tree, int key)
+{
+  bool found = false;
+
+  tree->root = WAVLNode_delete(tree->root, key, &found);
+  return found;
+}
+
+bool WAVL_search(WAVLTree* tree, int key)
+{
+  WAVLNode *x = tree->root;
+
+  while(x != NULL && x->key != key){
+    if(key < x->key){
+      x = x->left;
+    }
+    else {
+      x = x->right;
+    }
+  }
+  return x != NULL;
+}
+
+int WAVLNode_height(WAVLNode* node)
+{
+  int l_height, r_height;
+
+  if(node == NULL){
+    return ZERO;
+  }
+  l_height = WAVLNode_height(node->left);
+  r_height = WAVLNode_height(node->right);
+  if(l_height > r_height){
+    return l_height + ONE;
+  }
+  return r_height + ONE;
+}
+
+int WAVL_height(WAVLTree* tree)
+{
+  return WAVLNode_height(tree->root);
+}
+
+void WAVL_free(WAVLTree* tree)
+{
+  WAVL_recur(tree->root);
+  free(tree);
+}
+
+void WAVL_recur(WAVLNode* node)
+{
+  if(node != NULL){
+    WAVL_recur(node->left);
+    WAVL_recur(node->right);
+    free(node);
+  }
+}